@@ -0,0 +1,44 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of the model (src/bench/main.cpp); QtGui only
+# for the QTransform adaptor
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = distspectrum-bench
+TEMPLATE = app
+
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+
+SOURCES += \
+    src/bench/main.cpp
+
+HEADERS += \
+    src/model/dists.hpp \
+    src/model/model.hpp \
+    src/model/proc.hpp \
+    src/model/rng.hpp \
+    src/model/simd.hpp \
+    src/model/workpool.hpp \
+    src/view/2d.hpp
+
+EIGEN_DIR = $$PWD/../../../c++-extra-libs/eigen3.3
+
+INCLUDEPATH += $$EIGEN_DIR
+
+CONFIG(debug, debug|release) {
+  QMAKE_CXXFLAGS+=-O0
+  QMAKE_LFLAGS+=-O0
+}
+
+CONFIG(release, debug|release) {
+  CONFIG += optimize_full
+}
+
+# see distspectrum.pro
+native_simd {
+  QMAKE_CXXFLAGS += -march=native
+}
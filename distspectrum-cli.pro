@@ -0,0 +1,46 @@
+#-------------------------------------------------
+#
+# Headless spectra (src/cli/main.cpp): only the model, no Qt
+#
+#-------------------------------------------------
+
+TARGET = distspectrum-cli
+TEMPLATE = app
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    src/cli/main.cpp
+
+HEADERS += \
+    src/model/analytic.hpp \
+    src/model/celllist.hpp \
+    src/model/dists.hpp \
+    src/model/dualtree.hpp \
+    src/model/gridfft.hpp \
+    src/model/highdim.hpp \
+    src/model/model.hpp \
+    src/model/pointfile.hpp \
+    src/model/proc.hpp \
+    src/model/rng.hpp \
+    src/model/simd.hpp \
+    src/model/workpool.hpp
+
+EIGEN_DIR = $$PWD/../../../c++-extra-libs/eigen3.3
+
+INCLUDEPATH += $$EIGEN_DIR
+
+CONFIG(debug, debug|release) {
+  QMAKE_CXXFLAGS+=-O0
+  QMAKE_LFLAGS+=-O0
+}
+
+CONFIG(release, debug|release) {
+  CONFIG += optimize_full
+}
+
+# see distspectrum.pro
+native_simd {
+  QMAKE_CXXFLAGS += -march=native
+}
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Tests of the model (src/tests/*.cpp): only the model, no Qt;
+# each one exits non-zero on a failure
+#
+#-------------------------------------------------
+
+TARGET = distspectrum-tests
+TEMPLATE = app
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    src/tests/lookup_test.cpp
+
+HEADERS += \
+    src/model/model.hpp
+
+EIGEN_DIR = $$PWD/../../../c++-extra-libs/eigen3.3
+
+INCLUDEPATH += $$EIGEN_DIR
+
+CONFIG(debug, debug|release) {
+  QMAKE_CXXFLAGS+=-O0
+  QMAKE_LFLAGS+=-O0
+}
+
+CONFIG(release, debug|release) {
+  CONFIG += optimize_full
+}
@@ -23,9 +23,18 @@ SOURCES +=\
     src/view/l2xyhistogramcollector.cpp
 
 HEADERS  += \
+    src/model/analytic.hpp \
+    src/model/celllist.hpp \
     src/model/dists.hpp \
+    src/model/dualtree.hpp \
+    src/model/gridfft.hpp \
+    src/model/highdim.hpp \
     src/model/model.hpp \
+    src/model/pointfile.hpp \
     src/model/proc.hpp \
+    src/model/rng.hpp \
+    src/model/simd.hpp \
+    src/model/workpool.hpp \
     src/mainwindow.hpp \
     src/view/2d.hpp \
     src/view/pointcluster.hpp \
@@ -56,3 +65,9 @@ CONFIG(release, debug|release) {
   CONFIG += optimize_full
 }
 
+# `qmake CONFIG+=native_simd` targets the building CPU, enabling
+# the AVX/AVX-512 distance kernels (src/model/simd.hpp) where available
+native_simd {
+  QMAKE_CXXFLAGS += -march=native
+}
+
@@ -0,0 +1,472 @@
+/*
+ * File:   main.cpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+// Microbenchmarks of the model layer: fixed seeds, warmup runs, then
+// repeated timed runs of each case; the results (min/median/mean per run
+// and the throughput) go out as JSON, one case per line, and can be
+// compared against the JSON of an earlier run (`--compare`).
+// The qtrn_adaptor case needs QtGui, it's left out of the builds without it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../model/model.hpp"
+#include "../model/dists.hpp"
+#include "../model/proc.hpp"
+#include "../model/rng.hpp"
+
+#ifdef QT_GUI_LIB
+#include "../view/2d.hpp"
+#endif
+
+using coord_type=float;
+using point_type=distspctr::npoint<coord_type, 2>;
+using group_type=distspctr::npoint_grp<coord_type, 2>;
+using soa_type=distspctr::soa_points<coord_type, 2>;
+
+namespace {
+
+const char* usage=
+  "usage: distspectrum-bench [options]\n"
+  "  --reps N          timed runs of each case (default 5)\n"
+  "  --warmup N        untimed runs before (default 1)\n"
+  "  --filter TEXT     only the cases with TEXT in their name\n"
+  "  --output FILE     the JSON results (default: the standard output)\n"
+  "  --compare FILE    the JSON results of an earlier run: prints the median\n"
+  "                    ratios, exits with 3 if any case got slower\n"
+  "  --tolerance T     of the comparison, as a fraction (default 0.1)\n"
+;
+
+struct bench_options {
+  size_t reps;
+  size_t warmup;
+  std::string filter;
+  std::string output;
+  std::string compare;
+  double tolerance;
+
+  bench_options() : reps(5), warmup(1), filter(), output(), compare(), tolerance(0.1) { }
+};
+
+struct bench_result {
+  std::string name;
+  size_t items;       // processed by a run
+  double min_ns;
+  double median_ns;
+  double mean_ns;
+
+  double items_per_second() const {
+    return this->median_ns>0 ? this->items*1e9/this->median_ns : 0;
+  }
+};
+
+// keeps the results of the benchmarked code alive
+volatile double sink=0;
+
+class bench_runner {
+public:
+  explicit bench_runner(const bench_options& opts) : opts_(opts), results_() { }
+
+  // times `body` (a run over `items` items), unless filtered out
+  void run(const std::string& name, size_t items, std::function<double()> body) {
+    if(!this->opts_.filter.empty() && std::string::npos==name.find(this->opts_.filter)) {
+      return;
+    }
+    for(size_t i=0; i<this->opts_.warmup; i++) {
+      sink=sink+body();
+    }
+    std::vector<double> times;
+    for(size_t i=0; i<std::max(this->opts_.reps, size_t(1)); i++) {
+      auto start=std::chrono::steady_clock::now();
+      double ret=body();
+      auto end=std::chrono::steady_clock::now();
+      sink=sink+ret;
+      times.push_back(std::chrono::duration<double, std::nano>(end-start).count());
+    }
+    std::sort(times.begin(), times.end());
+    bench_result r;
+    r.name=name;
+    r.items=items;
+    r.min_ns=times.front();
+    r.median_ns=
+        (times.size() & 1)
+      ? times[times.size()/2]
+      : (times[times.size()/2-1]+times[times.size()/2])/2
+    ;
+    double total=0;
+    for(double t : times) {
+      total+=t;
+    }
+    r.mean_ns=total/times.size();
+    std::cerr << std::left << std::setw(60) << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(3) << r.median_ns/1e6 << " ms"
+              << std::setw(16) << std::setprecision(0) << r.items_per_second() << " items/s\n";
+    this->results_.push_back(r);
+  }
+
+  const std::vector<bench_result>& results() const {
+    return this->results_;
+  }
+
+private:
+  bench_options opts_;
+  std::vector<bench_result> results_;
+};
+
+// PointCluster::fill, without the Qt parts: uniform in the unit square...
+void fill_uniform(group_type& dest, size_t count, distspctr::philox_engine& random) {
+  std::uniform_real_distribution<double> d(0.0, 1.0);
+  for(size_t i=0; i<count; i++) {
+    double x=d(random), y=d(random);
+    dest.add({coord_type(x), coord_type(y)});
+  }
+}
+
+// ... or normal around its centre, clipped to a radius
+void fill_normal(group_type& dest, size_t count, double dev, double clipR, distspctr::philox_engine& random) {
+  std::normal_distribution<double> d(0.0, dev);
+  for(size_t i=0; i<count; i++) {
+    double x=d(random), y=d(random);
+    if(x*x+y*y<=clipR*clipR) {
+      dest.add({coord_type(x+0.5), coord_type(y+0.5)});
+    }
+  }
+}
+
+soa_type uniform_points(size_t count, unsigned long long seed) {
+  distspctr::philox_engine random(seed);
+  group_type grp;
+  fill_uniform(grp, count, random);
+  soa_type ret;
+  ret.reserve(count);
+  for(size_t i=0; i<grp.size(); i++) {
+    ret.push_back(grp[i]);
+  }
+  return ret;
+}
+
+class unit_box : public distspctr::bbox_npoint_cloud<group_type, coord_type, 2> {
+public:
+  unit_box() :
+    distspctr::bbox_npoint_cloud<group_type, coord_type, 2>(point_type(0, 0), point_type(1, 1))
+  {
+  }
+};
+
+void generation_cases(bench_runner& runner) {
+  const size_t count=1000000;
+  runner.run("generate/uniform/1M", count, [count]() {
+    distspctr::philox_engine random(1);
+    group_type grp;
+    fill_uniform(grp, count, random);
+    return static_cast<double>(grp.size());
+  });
+  runner.run("generate/normal_clipped/1M", count, [count]() {
+    distspctr::philox_engine random(2);
+    group_type grp;
+    fill_normal(grp, count, 0.15, 0.45, random);
+    return static_cast<double>(grp.size());
+  });
+}
+
+void histogram_cases(bench_runner& runner) {
+  const size_t count=10000000;
+  std::vector<coord_type> samples(count), squares(count);
+  distspctr::philox_engine random(3);
+  std::uniform_real_distribution<double> d(0.0, 1.5);
+  for(size_t i=0; i<count; i++) {
+    samples[i]=static_cast<coord_type>(d(random));
+    squares[i]=samples[i]*samples[i];
+  }
+  const size_t slotCounts[]={16, 256, 4096, 65536};
+  for(size_t slots : slotCounts) {
+    std::shared_ptr<distspctr::fixedl_histogram<coord_type>> h=
+      std::make_shared<distspctr::fixedl_histogram<coord_type>>(slots, 0, coord_type(1.42))
+    ;
+    std::ostringstream name;
+    name << "histogram/add_sample/slots=" << slots;
+    runner.run(name.str(), count, [h, &samples]() {
+      h->clear();
+      for(coord_type v : samples) {
+        h->add_sample(v);
+      }
+      return static_cast<double>(h->total_count());
+    });
+    name.str("");
+    name << "histogram/add_squared_sample/slots=" << slots;
+    runner.run(name.str(), count, [h, &squares]() {
+      h->clear();
+      for(coord_type v : squares) {
+        h->add_squared_sample(v);
+      }
+      return static_cast<double>(h->total_count());
+    });
+  }
+}
+
+void cloud_cases(bench_runner& runner) {
+  const size_t groups=4, perGroup=250000;
+  std::vector<std::shared_ptr<group_type>> suppliers;
+  distspctr::philox_engine random(4);
+  unit_box cloud;
+  for(size_t g=0; g<groups; g++) {
+    suppliers.push_back(std::make_shared<group_type>());
+    fill_uniform(*suppliers.back(), perGroup, random);
+    cloud.add(suppliers.back().get());
+  }
+  runner.run("cloud/points_copy/1M", groups*perGroup, [&cloud]() {
+    std::vector<point_type> dest;
+    cloud.points_copy(dest);
+    return static_cast<double>(dest.size());
+  });
+  const size_t calls=1000000;
+  runner.run("cloud/size/1M_calls", calls, [&cloud, calls]() {
+    double ret=0;
+    for(size_t i=0; i<calls; i++) {
+      ret+=cloud.size();
+    }
+    return ret;
+  });
+  runner.run("cloud/invalidate/250k_of_1M", perGroup, [&cloud, &suppliers]() {
+    cloud.invalidate(suppliers.front().get());
+    return static_cast<double>(cloud.size());
+  });
+}
+
+template <class DistCalc>
+void distance_cases(bench_runner& runner, const std::string& metric, const soa_type& small, const soa_type& large) {
+  // compute_distances, all the pairs of the small set, samples of the large one,
+  // binned into the same histogram as the engines below, to compare with them
+  size_t pairs=distspctr::triangle_pairs(small.size());
+  distspctr::fixedl_histogram<coord_type> proto(1024, 0, coord_type(1.42));
+  runner.run("compute_distances/exhaustive/"+metric+"/4k", pairs, [&small, &proto]() {
+    DistCalc calc;
+    distspctr::fixedl_histogram<coord_type> hist(proto);
+    hist.clear();
+    std::function<bool(double)> dest=[&hist](double d) {
+      hist.add_sample(static_cast<coord_type>(d));
+      return true;
+    };
+    distspctr::compute_distances<coord_type, 2>(small, dest, calc);
+    return static_cast<double>(hist.total_count());
+  });
+  const size_t samples=2000000;
+  runner.run("compute_distances/sampled/"+metric+"/2M_of_100k", samples, [&large, &proto, samples]() {
+    DistCalc calc;
+    distspctr::fixedl_histogram<coord_type> hist(proto);
+    hist.clear();
+    std::function<bool(double)> dest=[&hist](double d) {
+      hist.add_sample(static_cast<coord_type>(d));
+      return true;
+    };
+    distspctr::compute_distances<coord_type, 2>(large, dest, calc, samples, 7);
+    return static_cast<double>(hist.total_count());
+  });
+  // the engines of histogram_filler, on a single thread and on all of them
+  std::vector<distspctr::pair_block> blocks(1, distspctr::pair_block(0, small.size()));
+  const unsigned threadCounts[]={1, 0};
+  for(unsigned threads : threadCounts) {
+    std::string suffix=threads ? "/threads=1" : "/threads=all";
+    runner.run("compute_distances_tiled/"+metric+"/4k"+suffix, pairs, [&small, &blocks, &proto, threads]() {
+      DistCalc calc;
+      size_t ret=0;
+      distspctr::compute_distances_tiled<coord_type, 2>(
+        small, blocks, calc, proto,
+        [&ret](size_t, const distspctr::histogram<coord_type>& partial, size_t, bool) {
+          ret+=partial.total_count();
+          return true;
+        },
+        threads
+      );
+      return static_cast<double>(ret);
+    });
+    runner.run("compute_distances_sampled/"+metric+"/2M_of_100k"+suffix, samples, [&large, &proto, threads, samples]() {
+      DistCalc calc;
+      size_t ret=0;
+      std::vector<distspctr::pair_block> all(1, distspctr::pair_block(0, large.size()));
+      distspctr::compute_distances_sampled<coord_type, 2>(
+        large, all, std::vector<size_t>(1, samples), calc, proto,
+        [&ret](size_t, const distspctr::histogram<coord_type>& partial, size_t, bool) {
+          ret+=partial.total_count();
+          return true;
+        },
+        threads, 65536, 7
+      );
+      return static_cast<double>(ret);
+    });
+  }
+}
+
+#ifdef QT_GUI_LIB
+void transform_cases(bench_runner& runner) {
+  const size_t count=1000000;
+  soa_type points=uniform_points(count, 5);
+  // a perspective one, the costliest QTransform::map
+  QTransform trn(1.1, 0.05, 0.001, -0.02, 0.9, 0.002, 0.01, -0.03, 1.0);
+  runner.run("qtrn_adaptor/map/1M", count, [&points, &trn]() {
+    qtrn_adaptor adaptor(trn);
+    double ret=0;
+    for(size_t i=0; i<points.size(); i++) {
+      ret+=adaptor.map(points(i))(0);
+    }
+    return ret;
+  });
+}
+#endif
+
+void write_json(std::ostream& out, const bench_options& opts, const std::vector<bench_result>& results) {
+  out << std::setprecision(10);
+  out << "{\n"
+      << "  \"reps\": " << opts.reps << ",\n"
+      << "  \"warmup\": " << opts.warmup << ",\n"
+      << "  \"benchmarks\": [\n";
+  for(size_t i=0; i<results.size(); i++) {
+    const bench_result& r=results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"items\": " << r.items
+        << ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns
+        << ", \"mean_ns\": " << r.mean_ns
+        << ", \"items_per_second\": " << r.items_per_second() << "}"
+        << (i+1<results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+// The median times by name, from the JSON written by write_json
+std::map<std::string, double> read_medians(const std::string& path) {
+  std::ifstream in(path.c_str());
+  if(!in) {
+    throw std::runtime_error("can't open "+path);
+  }
+  std::map<std::string, double> ret;
+  std::string line;
+  const std::string nameKey="\"name\": \"", medianKey="\"median_ns\": ";
+  while(std::getline(in, line)) {
+    size_t name=line.find(nameKey), median=line.find(medianKey);
+    if(std::string::npos==name || std::string::npos==median) {
+      continue;
+    }
+    name+=nameKey.size();
+    size_t nameEnd=line.find('"', name);
+    ret[line.substr(name, nameEnd-name)]=std::atof(line.c_str()+median+medianKey.size());
+  }
+  return ret;
+}
+
+// prints the ratios of the medians; returns the number of cases slower than tolerated
+size_t compare(const std::vector<bench_result>& results, const std::map<std::string, double>& baseline, double tolerance) {
+  size_t ret=0;
+  std::cerr << "\n" << std::left << std::setw(60) << "case" << std::right
+            << std::setw(14) << "base ms" << std::setw(14) << "now ms" << std::setw(10) << "ratio\n";
+  for(const bench_result& r : results) {
+    auto found=baseline.find(r.name);
+    if(found==baseline.end() || !(found->second>0)) {
+      continue;
+    }
+    double ratio=r.median_ns/found->second;
+    bool slower=ratio>1+tolerance;
+    ret+=slower ? 1 : 0;
+    std::cerr << std::left << std::setw(60) << r.name << std::right << std::fixed
+              << std::setw(14) << std::setprecision(3) << found->second/1e6
+              << std::setw(14) << r.median_ns/1e6
+              << std::setw(10) << std::setprecision(2) << ratio
+              << (slower ? "  slower" : (ratio<1-tolerance ? "  faster" : "")) << "\n";
+  }
+  return ret;
+}
+
+bench_options parse_args(int argc, char* argv[]) {
+  bench_options ret;
+  for(int i=1; i<argc; i++) {
+    std::string arg=argv[i];
+    if(i+1>=argc) {
+      throw std::invalid_argument(arg);
+    }
+    std::string val=argv[++i];
+    if("--reps"==arg) {
+      ret.reps=std::strtoul(val.c_str(), nullptr, 10);
+    }
+    else if("--warmup"==arg) {
+      ret.warmup=std::strtoul(val.c_str(), nullptr, 10);
+    }
+    else if("--filter"==arg) {
+      ret.filter=val;
+    }
+    else if("--output"==arg) {
+      ret.output=val;
+    }
+    else if("--compare"==arg) {
+      ret.compare=val;
+    }
+    else if("--tolerance"==arg) {
+      ret.tolerance=std::atof(val.c_str());
+    }
+    else {
+      throw std::invalid_argument(arg);
+    }
+  }
+  return ret;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  bench_options opts;
+  try {
+    opts=parse_args(argc, argv);
+  }
+  catch(const std::invalid_argument&) {
+    std::cerr << usage;
+    return 2;
+  }
+  try {
+    std::map<std::string, double> baseline;
+    if(!opts.compare.empty()) {
+      baseline=read_medians(opts.compare);
+    }
+
+    bench_runner runner(opts);
+    generation_cases(runner);
+    histogram_cases(runner);
+    cloud_cases(runner);
+    soa_type small=uniform_points(4000, 6), large=uniform_points(100000, 7);
+    distance_cases<distspctr::l2<coord_type, 2>>(runner, "l2", small, large);
+    distance_cases<distspctr::mahalanobis<coord_type, 2, soa_type>>(runner, "mahalanobis", small, large);
+#ifdef QT_GUI_LIB
+    transform_cases(runner);
+#endif
+
+    if(opts.output.empty()) {
+      write_json(std::cout, opts, runner.results());
+    }
+    else {
+      std::ofstream out(opts.output.c_str());
+      write_json(out, opts, runner.results());
+      if(!out) {
+        throw std::runtime_error("can't write "+opts.output);
+      }
+    }
+    if(!opts.compare.empty() && compare(runner.results(), baseline, opts.tolerance)) {
+      return 3;
+    }
+  }
+  catch(const std::exception& e) {
+    std::cerr << "distspectrum-bench: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,632 @@
+/*
+ * File:   main.cpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+// Headless distance spectra: reads a point cloud from a file, computes
+// its spectrum with the src/model engines and writes it, with the timing,
+// as CSV or JSON. Planar clouds go through histogram_filler (all the metrics,
+// engines and the sampled mode), the other dimensions through dense_spectrum
+// (L2, exhaustive).
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../model/model.hpp"
+#include "../model/dists.hpp"
+#include "../model/highdim.hpp"
+#include "../model/pointfile.hpp"
+#include "../model/proc.hpp"
+
+using coord_type=float;
+
+namespace {
+
+const char* usage=
+  "usage: distspectrum-cli [options] <points-file>\n"
+  "  <points-file>        a planar float point file (see src/model/pointfile.hpp),\n"
+  "                       mapped in place, or a text file: one point per line, the\n"
+  "                       coordinates separated by blanks or commas; '#' starts a comment\n"
+  "  --metric l2|mahalanobis      (default l2; mahalanobis for planar points only)\n"
+  "  --slots N                    (default 256)\n"
+  "  --max R                      upper bound of the spectrum (default: bbox diagonal)\n"
+  "  --mode exhaustive|sampled    (default exhaustive)\n"
+  "  --samples N                  of the sampled mode (default 1000000)\n"
+  "  --tolerance T                sampled: stop when all slots are known within T\n"
+  "  --engine tiled|dual-tree|fft-grid|cell-list  exhaustive planar engine (default tiled);\n"
+  "                               fft-grid takes all the pairs, even if sampling\n"
+  "  --seed S                     of the sampled pairs (default 0)\n"
+  "  --threads N                  0 - as many as the hardware supports (default 0)\n"
+  "  --pin on|off                 bind each worker thread to a core, Linux only (default off)\n"
+  "  --format csv|json            (default csv)\n"
+  "  --output FILE                (default: the standard output)\n"
+  "  --stream N                   point files only: read blocks of N points instead of\n"
+  "                               mapping the file (exhaustive l2, for files larger than RAM)\n"
+;
+
+struct cli_options {
+  std::string input;
+  std::string output;
+  std::string metric;
+  std::string mode;
+  std::string format;
+  std::string engine_name;
+  bool engine_given;
+  size_t slots;
+  coord_type max_dist;
+  size_t samples;
+  size_t stream_len;    // 0 - not streamed
+  bool pin;
+  distspctr::fill_options fill;
+
+  cli_options() :
+    input(), output(), metric("l2"), mode("exhaustive"), format("csv"),
+    engine_name("tiled"), engine_given(false), slots(256), max_dist(0), samples(1000000),
+    stream_len(0), pin(false), fill()
+  {
+  }
+};
+
+// what got computed, how, and how long it took
+struct run_stats {
+  size_t points;
+  size_t dim;
+  std::string mode;     // exhaustive or sampled, as run
+  std::string engine;   // of the pairs, as run
+  unsigned threads;     // workers
+  size_t pairs;         // computed (or sampled)
+  double wall_seconds;
+  double sampling_error;
+  bool converged;
+
+  run_stats() :
+    points(0), dim(0), mode("exhaustive"), engine(), threads(0),
+    pairs(0), wall_seconds(0), sampling_error(0), converged(false)
+  {
+  }
+
+  double pairs_per_second() const {
+    return this->wall_seconds>0 ? this->pairs/this->wall_seconds : 0;
+  }
+};
+
+unsigned long long parse_count(const std::string& opt, const std::string& val) {
+  size_t used=0;
+  unsigned long long ret=0;
+  try {
+    ret=std::stoull(val, &used);
+  }
+  catch(const std::exception&) {
+    used=0;
+  }
+  if(0==used || used!=val.size() || '-'==val[0]) {
+    throw std::invalid_argument(opt+": not a non-negative integer: "+val);
+  }
+  return ret;
+}
+
+double parse_real(const std::string& opt, const std::string& val) {
+  size_t used=0;
+  double ret=0;
+  try {
+    ret=std::stod(val, &used);
+  }
+  catch(const std::exception&) {
+    used=0;
+  }
+  if(0==used || used!=val.size() || !(ret>=0)) {
+    throw std::invalid_argument(opt+": not a non-negative number: "+val);
+  }
+  return ret;
+}
+
+cli_options parse_args(int argc, char* argv[]) {
+  cli_options ret;
+  for(int i=1; i<argc; i++) {
+    std::string arg=argv[i];
+    if('-'!=arg[0] || 1==arg.size()) {
+      if(!ret.input.empty()) {
+        throw std::invalid_argument("more than one points file: "+arg);
+      }
+      ret.input=arg;
+      continue;
+    }
+    if("--help"==arg || "-h"==arg) {
+      throw std::invalid_argument("");
+    }
+    if(i+1>=argc) {
+      throw std::invalid_argument(arg+": missing value");
+    }
+    std::string val=argv[++i];
+    if("--metric"==arg) {
+      if("l2"!=val && "mahalanobis"!=val) {
+        throw std::invalid_argument("--metric: unknown "+val);
+      }
+      ret.metric=val;
+    }
+    else if("--slots"==arg) {
+      ret.slots=parse_count(arg, val);
+      if(0==ret.slots) {
+        throw std::invalid_argument("--slots: at least one");
+      }
+    }
+    else if("--max"==arg) {
+      ret.max_dist=static_cast<coord_type>(parse_real(arg, val));
+    }
+    else if("--mode"==arg) {
+      if("exhaustive"!=val && "sampled"!=val) {
+        throw std::invalid_argument("--mode: unknown "+val);
+      }
+      ret.mode=val;
+    }
+    else if("--samples"==arg) {
+      ret.samples=parse_count(arg, val);
+    }
+    else if("--tolerance"==arg) {
+      ret.fill.tolerance=parse_real(arg, val);
+    }
+    else if("--engine"==arg) {
+      if("tiled"==val) {
+        ret.fill.engine=distspctr::fill_engine::tiled;
+      }
+      else if("dual-tree"==val) {
+        ret.fill.engine=distspctr::fill_engine::dual_tree;
+      }
+      else if("fft-grid"==val) {
+        ret.fill.engine=distspctr::fill_engine::fft_grid;
+      }
+      else if("cell-list"==val) {
+        ret.fill.engine=distspctr::fill_engine::cell_list;
+      }
+      else {
+        throw std::invalid_argument("--engine: unknown "+val);
+      }
+      ret.engine_name=val;
+      ret.engine_given=true;
+    }
+    else if("--seed"==arg) {
+      ret.fill.seed=parse_count(arg, val);
+    }
+    else if("--threads"==arg) {
+      ret.fill.threads=static_cast<unsigned>(parse_count(arg, val));
+    }
+    else if("--pin"==arg) {
+      if("on"!=val && "off"!=val) {
+        throw std::invalid_argument("--pin: on or off, not "+val);
+      }
+      ret.pin=("on"==val);
+    }
+    else if("--format"==arg) {
+      if("csv"!=val && "json"!=val) {
+        throw std::invalid_argument("--format: unknown "+val);
+      }
+      ret.format=val;
+    }
+    else if("--stream"==arg) {
+      ret.stream_len=parse_count(arg, val);
+    }
+    else if("--output"==arg) {
+      ret.output=val;
+    }
+    else {
+      throw std::invalid_argument("unknown option "+arg);
+    }
+  }
+  if(ret.input.empty()) {
+    throw std::invalid_argument("no points file");
+  }
+  return ret;
+}
+
+// as the --engine option takes it
+const char* engine_name(distspctr::fill_engine engine) {
+  switch(engine) {
+    case distspctr::fill_engine::dual_tree:
+      return "dual-tree";
+    case distspctr::fill_engine::fft_grid:
+      return "fft-grid";
+    case distspctr::fill_engine::cell_list:
+      return "cell-list";
+    default:
+      return "tiled";
+  }
+}
+
+// The coordinates of all the points, one after the other; `dim` of each
+// (from the first point, all the others must match)
+void read_points(const std::string& path, std::vector<coord_type>& coords, size_t& dim) {
+  std::ifstream in(path.c_str());
+  if(!in) {
+    throw std::runtime_error("can't open "+path);
+  }
+  coords.clear();
+  dim=0;
+  std::string line;
+  size_t lineNo=0;
+  while(std::getline(in, line)) {
+    lineNo++;
+    for(char& c : line) {
+      if(','==c || ';'==c) {
+        c=' ';
+      }
+    }
+    std::istringstream fields(line);
+    std::string field;
+    size_t count=0;
+    while(fields >> field) {
+      if(0==count && '#'==field[0]) {
+        break;
+      }
+      char* end=nullptr;
+      double v=std::strtod(field.c_str(), &end);
+      if(*end) {
+        std::ostringstream msg;
+        msg << path << ":" << lineNo << ": not a coordinate: " << field;
+        throw std::runtime_error(msg.str());
+      }
+      coords.push_back(static_cast<coord_type>(v));
+      count++;
+    }
+    if(0==count) {
+      continue;
+    }
+    if(0==dim) {
+      dim=count;
+    }
+    else if(count!=dim) {
+      std::ostringstream msg;
+      msg << path << ":" << lineNo << ": " << count << " coordinates, expected " << dim;
+      throw std::runtime_error(msg.str());
+    }
+  }
+}
+
+// if starting as a point file (see distspctr::point_file_header)
+bool is_point_file(const std::string& path) {
+  char magic[8];
+  std::ifstream in(path.c_str(), std::ios::binary);
+  return
+       in.read(magic, sizeof(magic))
+    && 0==std::memcmp(magic, distspctr::point_file_header::expected_magic(), sizeof(magic))
+  ;
+}
+
+// histogram_filler's PointSupplier over a fixed set of points
+class planar_points {
+public:
+  using points_type=distspctr::soa_points<coord_type, 2>;
+
+  explicit planar_points(const std::vector<coord_type>& coords) : points_()
+  {
+    std::shared_ptr<points_type> pts=std::make_shared<points_type>();
+    pts->reserve(coords.size()/2);
+    for(size_t i=0; i+1<coords.size(); i+=2) {
+      pts->push_back(distspctr::npoint<coord_type, 2>(coords[i], coords[i+1]));
+    }
+    this->points_=pts;
+  }
+
+  std::shared_ptr<const points_type> snapshot() const {
+    return this->points_;
+  }
+
+private:
+  std::shared_ptr<const points_type> points_;
+};
+
+// histogram_filler's Observer, waited upon until done
+class completion {
+public:
+  completion() : done_(), result_(done_.get_future()) { }
+
+  void partial_progress(std::shared_ptr<distspctr::histogram<coord_type>>, size_t, size_t) {
+  }
+
+  void done(std::shared_ptr<distspctr::histogram<coord_type>>) {
+    this->done_.set_value();
+  }
+
+  bool wait(std::chrono::milliseconds timeout) {
+    return std::future_status::ready==this->result_.wait_for(timeout);
+  }
+
+private:
+  std::promise<void> done_;
+  std::future<void> result_;
+};
+
+using planar_type=distspctr::soa_points<coord_type, 2>;
+
+// of the bounding box of `pts`
+coord_type diag_len(const planar_type& pts) {
+  if(pts.empty()) {
+    return 0;
+  }
+  distspctr::npoint<coord_type, 2> lo=pts(0), hi=lo;
+  for(size_t i=1; i<pts.size(); i++) {
+    lo=lo.cwiseMin(pts(i));
+    hi=hi.cwiseMax(pts(i));
+  }
+  return (hi-lo).norm();
+}
+
+// The points in the space where the distance is the l2 one
+template <class Src> void whiten(
+  const Src& src, const distspctr::l2<coord_type, 2>&, planar_type& dest
+) {
+  dest.reserve(src.size());
+  for(size_t i=0; i<src.size(); i++) {
+    dest.push_back(src(i));
+  }
+}
+
+template <class Src, class Whitening> void whiten(
+  const Src& src, const Whitening& calc, planar_type& dest
+) {
+  Whitening updated(calc);
+  updated.update(&src);
+  updated.whiten(src, dest);
+}
+
+// Points - histogram_filler's PointSupplier
+template <class Points, class DistCalc>
+std::shared_ptr<distspctr::histogram<coord_type>> planar_spectrum(
+  const Points& points, const DistCalc& calc, const cli_options& opts, run_stats& stats
+) {
+  using filler_type=distspctr::histogram_filler<coord_type, 2, Points, completion>;
+  coord_type maxDist=opts.max_dist;
+  if(!(maxDist>0)) {
+    planar_type whitened;
+    whiten(*points.snapshot(), calc, whitened);
+    maxDist=diag_len(whitened);
+  }
+  std::shared_ptr<distspctr::histogram<coord_type>> ret=
+    std::make_shared<distspctr::fixedl_histogram<coord_type>>(opts.slots, 0, maxDist)
+  ;
+  size_t maxDists=
+      "sampled"==opts.mode
+    ? opts.samples
+    : std::numeric_limits<size_t>::max()
+  ;
+  filler_type filler(ret);
+  std::shared_ptr<completion> observer=std::make_shared<completion>();
+  auto start=std::chrono::steady_clock::now();
+  filler.start(points, calc, observer, 0, maxDists, opts.fill);
+  // the filler stops on its own when failing, without notifying
+  while(!observer->wait(std::chrono::milliseconds(20))) {
+    if(filler.stopped()) {
+      throw std::runtime_error("the computation failed");
+    }
+  }
+  auto end=std::chrono::steady_clock::now();
+  stats.sampling_error=filler.sampling_error();
+  stats.converged=filler.converged();
+  filler.stop();
+  // the filler may take another route than asked (e.g. the grid takes all
+  // the pairs, the engines not applying fall back to tiled)
+  distspctr::fill_stats ran=filler.stats();
+  stats.mode=ran.sampled ? "sampled" : "exhaustive";
+  stats.engine=ran.sampled ? "sampled" : engine_name(ran.engine);
+  stats.wall_seconds=std::chrono::duration<double>(end-start).count();
+  stats.pairs=ret->total_count();
+  return ret;
+}
+
+template <class Points>
+std::shared_ptr<distspctr::histogram<coord_type>> planar_spectrum(
+  const Points& points, const cli_options& opts, run_stats& stats
+) {
+  if("mahalanobis"==opts.metric) {
+    using snapshot_type=typename decltype(points.snapshot())::element_type;
+    using mahalanobis_type=distspctr::mahalanobis<
+      coord_type, 2, typename std::remove_const<snapshot_type>::type
+    >;
+    return planar_spectrum(points, mahalanobis_type(opts.fill.threads), opts, stats);
+  }
+  return planar_spectrum(points, distspctr::l2<coord_type, 2>(), opts, stats);
+}
+
+std::shared_ptr<distspctr::histogram<coord_type>> streamed_spectrum(
+  distspctr::point_file_reader<coord_type, 2>& reader, const cli_options& opts, run_stats& stats
+) {
+  if("l2"!=opts.metric || "sampled"==opts.mode) {
+    throw std::invalid_argument("only the exhaustive l2 spectrum when streaming");
+  }
+  if(opts.engine_given && "tiled"!=opts.engine_name) {
+    throw std::invalid_argument("--engine: the streamed block pairs get tiled, not "+opts.engine_name);
+  }
+  stats.engine="streamed";
+  coord_type maxDist=opts.max_dist;
+  if(!(maxDist>0)) {
+    // a pass through the file for the bounding box
+    distspctr::npoint<coord_type, 2> lo=distspctr::npoint<coord_type, 2>::Zero(), hi=lo;
+    planar_type block;
+    for(size_t b=0; b<reader.size(); b+=opts.stream_len) {
+      block.clear();
+      reader.read(b, std::min(reader.size(), b+opts.stream_len), block);
+      for(size_t i=0; i<block.size(); i++) {
+        lo=(b+i) ? lo.cwiseMin(block(i)) : block(i);
+        hi=(b+i) ? hi.cwiseMax(block(i)) : block(i);
+      }
+    }
+    maxDist=(hi-lo).norm();
+  }
+  std::shared_ptr<distspctr::histogram<coord_type>> ret=
+    std::make_shared<distspctr::fixedl_histogram<coord_type>>(opts.slots, 0, maxDist)
+  ;
+  distspctr::l2<coord_type, 2> calc;
+  auto start=std::chrono::steady_clock::now();
+  distspctr::compute_distances_streamed<coord_type, 2>(
+    reader, calc, *ret,
+    [&ret](size_t, const distspctr::histogram<coord_type>& partial, size_t, bool) {
+      ret->merge(partial);
+      return true;
+    },
+    opts.fill.threads, opts.stream_len, opts.fill.tile_len
+  );
+  auto end=std::chrono::steady_clock::now();
+  stats.wall_seconds=std::chrono::duration<double>(end-start).count();
+  stats.pairs=ret->total_count();
+  return ret;
+}
+
+std::shared_ptr<distspctr::histogram<coord_type>> embedded_spectrum(
+  const std::vector<coord_type>& coords, size_t dim, const cli_options& opts, run_stats& stats
+) {
+  if("l2"!=opts.metric || "sampled"==opts.mode) {
+    throw std::invalid_argument("only the exhaustive l2 spectrum for non-planar points");
+  }
+  if(opts.engine_given) {
+    throw std::invalid_argument("--engine: planar points only, the others go through dense-gram");
+  }
+  stats.engine="dense-gram";
+  distspctr::dense_points<coord_type> points(coords.data(), coords.size()/dim, dim);
+  auto start=std::chrono::steady_clock::now();
+  std::shared_ptr<distspctr::histogram<coord_type>> ret=
+    distspctr::dense_spectrum(points, opts.slots, opts.max_dist, opts.fill.threads)
+  ;
+  auto end=std::chrono::steady_clock::now();
+  stats.wall_seconds=std::chrono::duration<double>(end-start).count();
+  stats.pairs=ret->total_count();
+  return ret;
+}
+
+void write_csv(
+  std::ostream& out, const distspctr::histogram<coord_type>& h,
+  const cli_options& opts, const run_stats& stats
+) {
+  out << "# points=" << stats.points << " dim=" << stats.dim
+      << " metric=" << opts.metric << " mode=" << stats.mode
+      << " engine=" << stats.engine << " threads=" << stats.threads
+      << " seed=" << opts.fill.seed << "\n"
+      << "# pairs=" << stats.pairs << " overflow=" << h.overflow_count()
+      << " wall_seconds=" << stats.wall_seconds
+      << " pairs_per_second=" << stats.pairs_per_second()
+      << " sampling_error=" << stats.sampling_error
+      << " converged=" << (stats.converged ? 1 : 0) << "\n"
+      << "slot,lo,hi,count,fraction\n";
+  double total=h.total_count();
+  for(size_t i=0; i<h.num_slots(); i++) {
+    size_t count=h.slot_count(i);
+    out << i << "," << h.slot_min(i) << "," << h.slot_max(i) << ","
+        << count << "," << (total>0 ? count/total : 0.0) << "\n";
+  }
+}
+
+void write_json(
+  std::ostream& out, const distspctr::histogram<coord_type>& h,
+  const cli_options& opts, const run_stats& stats
+) {
+  out << "{\n"
+      << "  \"points\": " << stats.points << ",\n"
+      << "  \"dim\": " << stats.dim << ",\n"
+      << "  \"metric\": \"" << opts.metric << "\",\n"
+      << "  \"mode\": \"" << stats.mode << "\",\n"
+      << "  \"engine\": \"" << stats.engine << "\",\n"
+      << "  \"threads\": " << stats.threads << ",\n"
+      << "  \"seed\": " << opts.fill.seed << ",\n"
+      << "  \"min\": " << h.min_sample_value() << ",\n"
+      << "  \"max\": " << h.max_sample_value() << ",\n"
+      << "  \"pairs\": " << stats.pairs << ",\n"
+      << "  \"overflow\": " << h.overflow_count() << ",\n"
+      << "  \"wall_seconds\": " << stats.wall_seconds << ",\n"
+      << "  \"pairs_per_second\": " << stats.pairs_per_second() << ",\n"
+      << "  \"sampling_error\": " << stats.sampling_error << ",\n"
+      << "  \"converged\": " << (stats.converged ? "true" : "false") << ",\n"
+      << "  \"counts\": [";
+  for(size_t i=0; i<h.num_slots(); i++) {
+    out << (i ? ", " : "") << h.slot_count(i);
+  }
+  out << "]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  cli_options opts;
+  try {
+    opts=parse_args(argc, argv);
+  }
+  catch(const std::invalid_argument& e) {
+    if(*e.what()) {
+      std::cerr << "distspectrum-cli: " << e.what() << "\n";
+    }
+    std::cerr << usage;
+    return 2;
+  }
+  distspctr::compute_pool::configure_shared(opts.fill.threads, opts.pin);
+  try {
+    run_stats stats;
+    stats.threads=distspctr::work_stealing_pool(opts.fill.threads).workers();
+    std::shared_ptr<distspctr::histogram<coord_type>> result;
+    if(is_point_file(opts.input) && opts.stream_len) {
+      distspctr::point_file_reader<coord_type, 2> reader(opts.input);
+      stats.dim=2;
+      stats.points=reader.size();
+      result=streamed_spectrum(reader, opts, stats);
+    }
+    else if(is_point_file(opts.input)) {
+      // mapped, read in place
+      std::shared_ptr<const distspctr::mapped_points<coord_type, 2>> points=
+        distspctr::mapped_points<coord_type, 2>::open(opts.input)
+      ;
+      stats.dim=2;
+      stats.points=points->size();
+      result=planar_spectrum(*points, opts, stats);
+    }
+    else {
+      std::vector<coord_type> coords;
+      read_points(opts.input, coords, stats.dim);
+      stats.points=stats.dim ? coords.size()/stats.dim : 0;
+      if(2==stats.dim) {
+        result=planar_spectrum(planar_points(coords), opts, stats);
+      }
+      else {
+        if(0==stats.dim) {
+          throw std::runtime_error("no points in "+opts.input);
+        }
+        result=embedded_spectrum(coords, stats.dim, opts, stats);
+      }
+    }
+
+
+    std::ofstream file;
+    if(!opts.output.empty()) {
+      file.open(opts.output.c_str());
+      if(!file) {
+        throw std::runtime_error("can't write "+opts.output);
+      }
+    }
+    std::ostream& out=opts.output.empty() ? std::cout : file;
+    out << std::setprecision(9);
+    if("json"==opts.format) {
+      write_json(out, *result, opts, stats);
+    }
+    else {
+      write_csv(out, *result, opts, stats);
+    }
+  }
+  catch(const std::invalid_argument& e) {
+    // an option not applying to the points
+    std::cerr << "distspectrum-cli: " << e.what() << "\n";
+    return 2;
+  }
+  catch(const std::exception& e) {
+    std::cerr << "distspectrum-cli: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
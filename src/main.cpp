@@ -1,5 +1,6 @@
 #include "mainwindow.hpp"
 #include <QApplication>
+#include <QCommandLineParser>
 
 #include <ctime>
 #include <random>
@@ -14,7 +15,34 @@ int main(int argc, char *argv[])
 {
 
   QApplication a(argc, argv);
+
+  QCommandLineParser args;
+  args.addHelpOption();
+  QCommandLineOption statsDump(
+    "stats-dump", "Writes the throughput and timings of the updates to stderr every <seconds>.",
+    "seconds"
+  );
+  args.addOption(statsDump);
+  QCommandLineOption threads(
+    "threads", "Workers computing the spectra, 0 - as many as the cores (default 0).",
+    "count", "0"
+  );
+  args.addOption(threads);
+  QCommandLineOption pinThreads(
+    "pin-threads", "Binds each worker computing the spectra to a core (Linux only)."
+  );
+  args.addOption(pinThreads);
+  args.process(a);
+
+  // before anything gets computed
+  distspctr::compute_pool::configure_shared(
+    args.value(threads).toUInt(), args.isSet(pinThreads)
+  );
+
   MainWindow w;
+  if(args.isSet(statsDump)) {
+    w.setStatsDump(static_cast<int>(args.value(statsDump).toDouble()*1000));
+  }
 
   w.show();
 
@@ -6,8 +6,28 @@
 
 #include <QLineSeries>
 
+#include <iostream>
+
 #define BASE 10
 
+// `what`: 1.2 Mpairs/s, the times and the share of the pairs done by each worker
+static QString stats_text(const QString& what, const distspctr::fill_stats& stats) {
+  auto ms=[](double seconds) { return QString::number(seconds*1000, 'f', 0); };
+  QString load;
+  for(size_t w=0; w<stats.worker_pairs.size(); w++) {
+    load+=(w ? "/" : "")+QString::number(stats.pairs ? 100*stats.worker_pairs[w]/stats.pairs : 0);
+  }
+  return QString("%1: %2 Mpairs/s%3  compute %4 (binning %5 per worker)  merge %6  notify %7  snapshot %8  stop %9 ms  load %10%")
+    .arg(what)
+    .arg(stats.pairs_per_second()/1e6, 0, 'f', 2)
+    .arg(QString(stats.running ? "" : " (idle)"))
+    .arg(ms(stats.compute_seconds)).arg(ms(stats.bin_seconds_per_worker()))
+    .arg(ms(stats.merge_seconds)).arg(ms(stats.notify_seconds))
+    .arg(ms(stats.snapshot_seconds)).arg(ms(stats.stop_seconds))
+    .arg(load.isEmpty() ? QString("-") : load)
+  ;
+}
+
 inline void compute_yrange(qreal& minY, qreal& maxY) {
   qreal minUnit=
       (minY==0)
@@ -42,7 +62,8 @@ inline void compute_yrange(qreal& minY, qreal& maxY) {
 MainWindow::MainWindow(QWidget *parent) :
   QMainWindow(parent),
   ui(new Ui::MainWindow),
-  experimental_(nullptr), baseline_(nullptr), diff_(nullptr)
+  experimental_(nullptr), baseline_(nullptr), diff_(nullptr),
+  stats_timer_(nullptr), dump_timer_(nullptr)
 {
   ui->setupUi(this);
 
@@ -74,6 +95,15 @@ MainWindow::MainWindow(QWidget *parent) :
       src->fillDiffSeries(*this->diff_, &mins[2], &maxes[2]);
       this->ui->experProgress->setValue(int(expProgress*100));
       this->ui->baselineProgress->setValue(int(baselineProgress*100));
+      qreal expError, baselineError;
+      src->samplingErrors(expError, baselineError);
+      auto errorText=[](qreal err) {
+        return err>0 ? QString("\u00b1%1").arg(err, 0, 'f', 4) : QString("exact");
+      };
+      this->ui->samplingError->setText(
+        QString("Custom: %1  Baseline: %2").arg(errorText(expError), errorText(baselineError))
+      );
+      this->showFillStats();
       // unwrapped bubble-sort down
       if(mins[1]>mins[2]) std::swap(mins[1], mins[2]);
       if(mins[0]>mins[1]) std::swap(mins[0], mins[1]);
@@ -114,6 +144,38 @@ MainWindow::MainWindow(QWidget *parent) :
 
   this->ui->chart->setChart(this->chart_);
 
+  // the elapsed times keep going between the progress updates
+  this->stats_timer_=new QTimer(this);
+  QObject::connect(this->stats_timer_, &QTimer::timeout, this, &MainWindow::showFillStats);
+  this->stats_timer_->start(500);
+}
+
+void MainWindow::setStatsDump(int periodMs) {
+  if(!this->dump_timer_) {
+    this->dump_timer_=new QTimer(this);
+    QObject::connect(this->dump_timer_, &QTimer::timeout, this, &MainWindow::dumpFillStats);
+  }
+  if(periodMs>0) {
+    this->dump_timer_->start(periodMs);
+  }
+  else {
+    this->dump_timer_->stop();
+  }
+}
+
+void MainWindow::showFillStats() {
+  distspctr::fill_stats expStats, baselineStats;
+  this->ui->ctrl->fillStats(expStats, baselineStats);
+  this->ui->fillStats->setText(
+    stats_text("Custom", expStats)+"\n"+stats_text("Baseline", baselineStats)
+  );
+}
+
+void MainWindow::dumpFillStats() {
+  distspctr::fill_stats expStats, baselineStats;
+  this->ui->ctrl->fillStats(expStats, baselineStats);
+  std::cerr << stats_text("Custom", expStats).toStdString() << "\n"
+            << stats_text("Baseline", baselineStats).toStdString() << std::endl;
 }
 
 MainWindow::~MainWindow()
@@ -2,6 +2,7 @@
 #define MAINWINDOW_HPP
 
 #include <QMainWindow>
+#include <QTimer>
 #include <QtCharts/QChartView>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QValueAxis>
@@ -22,9 +23,14 @@ public:
   explicit MainWindow(QWidget *parent = 0);
   ~MainWindow();
 
-
+  // the fill stats to stderr every `periodMs`, 0 - never
+  void setStatsDump(int periodMs);
 
 private:
+  void showFillStats();
+
+  void dumpFillStats();
+
   Ui::MainWindow *ui;
 
   QLineSeries *experimental_;
@@ -32,6 +38,8 @@ private:
   QLineSeries *diff_;
   QChart* chart_;
   QValueAxis* y_axis_;
+  QTimer* stats_timer_;
+  QTimer* dump_timer_;
 
 };
 
@@ -0,0 +1,91 @@
+/*
+ * File:   analytic.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef ANALYTIC_HPP
+#define ANALYTIC_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "model.hpp"
+
+namespace distspctr {
+
+// Closed forms for the spectra of the L2 distances between points
+// uniformly spread over simple shapes.
+
+// P(|p-q|<=r) for p, q independent and uniformly distributed over a w*h rectangle.
+// The difference p-q has the density (w-|x|)(h-|y|)/(w*h)^2 over [-w,w]x[-h,h],
+// integrated over the disk of radius `r` (one quadrant times 4):
+//   F(r)=4/(w*h)^2 * int_0^min(w,r) (w-x)*Y(x) dx,   Y(x)=h*y-y^2/2, y=min(h, sqrt(r^2-x^2))
+// The integral splits where the circle leaves the y=h edge: a polynomial
+// part, then the arc part, with int sqrt(r^2-x^2) as the only non-polynomial term.
+template <typename C> long double rect_distance_cdf(C w, C h, C r) {
+  long double a=w, b=h, rr=r;
+  if(!(a>0) || !(b>0)) {
+    return rr>=0 ? 1.0L : 0.0L;
+  }
+  if(rr<=0) {
+    return 0;
+  }
+  if(rr*rr>=a*a+b*b) {
+    return 1;
+  }
+  long double r2=rr*rr;
+  // Y(x)=h^2/2 while the circle is above y=h
+  long double x0=(rr>b) ? std::min(a, std::sqrt(r2-b*b)) : 0.0L;
+  long double x1=std::min(a, rr);
+  long double ret=b*b/2*(a*x0-x0*x0/2);
+  // (w-x)*(h*s(x)-(r^2-x^2)/2), s(x)=sqrt(r^2-x^2), over [x0, x1]
+  auto primitive=[a, b, rr, r2](long double x) {
+    long double s=std::sqrt(std::max(0.0L, r2-x*x));
+    long double ratio=std::min(1.0L, x/rr);
+    long double intS=(x*s+r2*std::asin(ratio))/2;  // int s(x)
+    long double intXS=-s*s*s/3;                     // int x*s(x)
+    long double poly=a*(r2*x-x*x*x/3)-(r2*x*x/2-x*x*x*x/4);
+    return b*(a*intS-intXS)-poly/2;
+  };
+  if(x1>x0) {
+    ret+=primitive(x1)-primitive(x0);
+  }
+  ret*=4/(a*a*b*b);
+  return std::min(1.0L, std::max(0.0L, ret));
+}
+
+// Fills `dest` with `samples` distances distributed as the ones between
+// points uniformly spread over a w*h rectangle: each slot gets the
+// probability mass of the values it counts (see fixedl_histogram::slot_range),
+// rounded so that the counts add up. The mass above the histogram's
+// range goes to its overflow, the one below is left out, like the
+// out-of-range samples.
+template <typename C> void fill_rect_spectrum(
+  fixedl_histogram<C>& dest, C w, C h, size_t samples=size_t(1)<<30
+) {
+  size_t len=dest.num_slots();
+  long double cumulated=0;
+  size_t assigned=0;
+  for(size_t i=0; i<len; i++) {
+    long double lo, hi;
+    dest.slot_range(i, lo, hi);
+    if(!(hi>lo)) { // a single value has no mass
+      continue;
+    }
+    long double mass=rect_distance_cdf<long double>(w, h, hi)-rect_distance_cdf<long double>(w, h, lo);
+    cumulated+=mass*samples;
+    size_t upTo=static_cast<size_t>(std::llround(cumulated));
+    dest.add_to_slot(i, upTo-assigned);
+    assigned=upTo;
+  }
+  long double above=1-rect_distance_cdf<long double>(w, h, dest.max_sample_value());
+  cumulated+=above*samples;
+  dest.add_overflow(static_cast<size_t>(std::llround(cumulated))-assigned);
+}
+
+} // namespace distspctr
+
+#endif /* ANALYTIC_HPP */
@@ -0,0 +1,224 @@
+/*
+ * File:   celllist.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef CELLLIST_HPP
+#define CELLLIST_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "model.hpp"
+
+namespace distspctr {
+
+// Uniform grid of cubic cells over a box, `reach` cells per `reach_len`, the
+// cells numbered (keyed) row-major. Two points closer than `reach_len` are in
+// the same or in neighbouring cells: at most `reach` cells apart on every axis,
+// the cells in between (max(0, |offset|-1) per axis) less than `reach` apart.
+template <typename C, size_t DIM=2>
+class cell_grid {
+public:
+  using point_type=npoint<C, DIM>;
+
+  // The side is enlarged if needed to keep the count of cells within
+  // 2^48, which is still good for the above (only coarser).
+  cell_grid(const point_type& lo, const point_type& hi, long double reach_len, size_t reach=1) :
+    lo_(lo), side_(), inv_side_(), reach_(std::max(reach, size_t(1))), cells_(), strides_()
+  {
+    this->side_=reach_len/this->reach_;
+    long double extent=0;
+    for(size_t d=0; d<DIM; d++) {
+      extent=std::max(extent, static_cast<long double>(hi(d))-lo(d));
+    }
+    long double minSide=extent/std::pow(2.0L, 48.0L/DIM);
+    if(!(this->side_>=minSide) || !(this->side_>0)) {
+      this->side_=minSide>0 ? minSide : 1;
+    }
+    this->inv_side_=1/this->side_;
+    size_t stride=1;
+    for(size_t d=DIM; d-->0; ) {
+      this->strides_[d]=stride;
+      this->cells_[d]=this->index((static_cast<long double>(hi(d))-lo(d))*this->inv_side_)+1;
+      stride*=this->cells_[d];
+    }
+  }
+
+  long double side() const {
+    return this->side_;
+  }
+
+  size_t reach() const {
+    return this->reach_;
+  }
+
+  size_t key(const point_type& p) const {
+    size_t ret=0;
+    for(size_t d=0; d<DIM; d++) {
+      size_t ix=this->index((static_cast<long double>(p(d))-this->lo_(d))*this->inv_side_);
+      ret+=std::min(ix, this->cells_[d]-1)*this->strides_[d];
+    }
+    return ret;
+  }
+
+  // The keys of the cells neighbouring the `key` one (itself included), into
+  // `dest` as ascending ranges [first, second) of consecutive keys.
+  // With `half`, only one of each pair of opposite neighbours and not the cell
+  // itself: each pair of neighbouring cells shows up once when going through all cells.
+  void neighbours(size_t key, bool half, std::vector<std::pair<size_t, size_t>>& dest) const {
+    dest.clear();
+    size_t ix[DIM];
+    for(size_t d=0; d<DIM; d++) {
+      ix[d]=(key/this->strides_[d]) % this->cells_[d];
+    }
+    const long reach=static_cast<long>(this->reach_);
+    long offset[DIM];
+    std::fill(offset, offset+DIM, -reach);
+    for(;;) {
+      // first non-zero offset positive
+      long lead=0;
+      // whole cells in between, squared
+      long gaps=0;
+      for(size_t d=0; d<DIM; d++) {
+        if(0==lead) {
+          lead=offset[d];
+        }
+        long gap=std::max(std::labs(offset[d])-1, 0L);
+        gaps+=gap*gap;
+      }
+      bool inside=(gaps<reach*reach);
+      size_t neighbour=0;
+      for(size_t d=0; d<DIM && inside; d++) {
+        long pos=static_cast<long>(ix[d])+offset[d];
+        inside=(pos>=0 && pos<static_cast<long>(this->cells_[d]));
+        neighbour+=static_cast<size_t>(pos)*this->strides_[d];
+      }
+      if(inside && (!half || lead>0)) {
+        if(!dest.empty() && dest.back().second==neighbour) {
+          dest.back().second++;
+        }
+        else {
+          dest.push_back(std::make_pair(neighbour, neighbour+1));
+        }
+      }
+      size_t d=DIM;
+      while(d>0 && reach==offset[d-1]) {
+        offset[--d]=-reach;
+      }
+      if(0==d) {
+        break;
+      }
+      offset[d-1]++;
+    }
+  }
+
+private:
+  static size_t index(long double pos) {
+    return pos>0 ? static_cast<size_t>(pos) : 0;
+  }
+
+  point_type lo_;
+  long double side_;
+  long double inv_side_;
+  size_t reach_;
+  size_t cells_[DIM];
+  size_t strides_[DIM];
+};
+
+// A cell_grid reach for `count` points spread over the box [lo, hi]: the
+// cells are made finer until some 12 points are expected in each (at most 8
+// cells per `reach_len`). Finer cells leave fewer of the far pairs in the
+// neighbouring cells, and the more of them there are the longer it takes to
+// go through them.
+template <typename C, size_t DIM>
+size_t cell_grid_reach(
+  size_t count, const npoint<C, DIM>& lo, const npoint<C, DIM>& hi, long double reach_len
+) {
+  long double expected=count;
+  for(size_t d=0; d<DIM; d++) {
+    long double extent=static_cast<long double>(hi(d))-lo(d);
+    if(extent>reach_len) {
+      expected*=reach_len/extent;
+    }
+  }
+  long double reach=std::floor(std::pow(expected/12, 1.0L/DIM));
+  return reach>=8 ? 8 : (reach>=1 ? static_cast<size_t>(reach) : 1);
+}
+
+// The points of a range, in SoA layout, grouped by the cell_grid cell they fall into
+template <typename C, size_t DIM=2>
+class cell_list {
+public:
+  // the points [begin, end) of `src` (`operator()(size_t) const`)
+  template <class Supplier>
+  cell_list(const Supplier& src, size_t begin, size_t end, const cell_grid<C, DIM>& grid) :
+    points_(), keys_(), starts_()
+  {
+    size_t len=end-begin;
+    std::vector<size_t> keys(len), order(len);
+    for(size_t i=0; i<len; i++) {
+      keys[i]=grid.key(src(begin+i));
+    }
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(
+      order.begin(), order.end(),
+      [&keys](size_t a, size_t b) { return keys[a]<keys[b]; }
+    );
+    this->points_.reserve(len);
+    for(size_t i=0; i<len; i++) {
+      size_t k=keys[order[i]];
+      if(this->keys_.empty() || this->keys_.back()!=k) {
+        this->keys_.push_back(k);
+        this->starts_.push_back(i);
+      }
+      this->points_.push_back(src(begin+order[i]));
+    }
+    this->starts_.push_back(len);
+  }
+
+  // of the non-empty cells
+  size_t cell_count() const {
+    return this->keys_.size();
+  }
+
+  size_t key(size_t cellIx) const {
+    return this->keys_[cellIx];
+  }
+
+  // the points of a cell are [begin(cellIx), end(cellIx)) of points()
+  size_t begin(size_t cellIx) const {
+    return this->starts_[cellIx];
+  }
+
+  size_t end(size_t cellIx) const {
+    return this->starts_[cellIx+1];
+  }
+
+  // the points of the cells keyed [keyBeg, keyEnd), as [first, second) of
+  // points(); consecutive keys are contiguous points
+  std::pair<size_t, size_t> points_of(size_t keyBeg, size_t keyEnd) const {
+    size_t first=std::lower_bound(this->keys_.begin(), this->keys_.end(), keyBeg)-this->keys_.begin();
+    size_t last=std::lower_bound(this->keys_.begin()+first, this->keys_.end(), keyEnd)-this->keys_.begin();
+    return std::make_pair(this->starts_[first], this->starts_[last]);
+  }
+
+  const soa_points<C, DIM>& points() const {
+    return this->points_;
+  }
+
+private:
+  soa_points<C, DIM> points_;
+  std::vector<size_t> keys_;
+  std::vector<size_t> starts_;
+};
+
+} // namespace distspctr
+
+#endif /* CELLLIST_HPP */
@@ -8,12 +8,14 @@
 #ifndef DISTS_HPP
 #define DISTS_HPP
 
-#include <chrono>
-#include <random>
+#include <algorithm>
+#include <vector>
 
 #include <Eigen/Dense>
 
 #include "model.hpp"
+#include "simd.hpp"
+#include "workpool.hpp"
 
 namespace distspctr {
 
@@ -25,100 +27,210 @@ public:
     Coord ret=diff.norm();
     return ret;
   }
+
+  // batch form: the distances between `p0` and `count` points given as
+  // DIM coordinate columns (see soa_points::coords), into dest[0, count)
+  void operator()(
+    const npoint<Coord, DIM> &p0, const Coord* const* cols, size_t count,
+    Coord* dest
+  ) const {
+    simd::l2_batch<Coord, DIM, true>(p0.data(), cols, count, dest);
+  }
+
+  // the squared distances, for histograms binning in the squared domain
+  Coord squared(const npoint<Coord, DIM> &p0, const npoint<Coord, DIM> &p1) const {
+    npoint<Coord, DIM> diff=p0-p1;
+    return diff.squaredNorm();
+  }
+
+  void squared(
+    const npoint<Coord, DIM> &p0, const Coord* const* cols, size_t count,
+    Coord* dest
+  ) const {
+    simd::l2_batch<Coord, DIM, false>(p0.data(), cols, count, dest);
+  }
 };
 
-// Supplier must provide `operator(size_t i) const` with a result
-//  assignable to `npoint<internal_type,DIM>`
+// Running mean and co-moments (sum of the outer products of the deviations)
+// of a set of points: Welford's update for a point, Chan et al. for merging
+// two sets. Both stable against the cancellations of the textbook two sums.
+template <typename T, size_t DIM>
+struct covariance_accumulator {
+  using point_type=npoint<T, DIM>;
+  using matrix_type=Eigen::Matrix<T, DIM, DIM>;
+
+  size_t count;
+  point_type mean;
+  matrix_type comoments;
+
+  covariance_accumulator() : count(0), mean(), comoments() {
+    this->mean.setZero();
+    this->comoments.setZero();
+  }
+
+  void add(const point_type& x) {
+    this->count++;
+    point_type delta=x-this->mean;
+    this->mean+=delta/static_cast<T>(this->count);
+    this->comoments+=delta.transpose()*(x-this->mean);
+  }
+
+  void merge(const covariance_accumulator& o) {
+    if(0==o.count) {
+      return;
+    }
+    if(0==this->count) {
+      *this=o;
+      return;
+    }
+    T n=static_cast<T>(this->count+o.count);
+    T weight=static_cast<T>(this->count)*static_cast<T>(o.count)/n;
+    point_type delta=o.mean-this->mean;
+    this->mean+=delta*(static_cast<T>(o.count)/n);
+    this->comoments+=o.comoments+delta.transpose()*delta*weight;
+    this->count+=o.count;
+  }
+
+  // the sample covariance
+  matrix_type covariance() const {
+    matrix_type ret;
+    if(this->count>1) {
+      ret=this->comoments/static_cast<T>(this->count-1);
+    }
+    else {
+      ret.setZero();
+    }
+    return ret;
+  }
+};
+
+// The covariance_accumulator of the points of `src` (`size()`, `operator()(size_t)`
+// with a result assignable to npoint<T,DIM>), chunks of `chunk_len` points
+// accumulated in parallel then merged pairwise. The chunking doesn't depend
+// on the number of threads, neither does the result.
+template <typename T, size_t DIM, class Supplier>
+covariance_accumulator<T, DIM> accumulate_covariance(
+  const Supplier& src, unsigned threads=0, size_t chunk_len=4096
+) {
+  size_t len=src.size();
+  size_t chunks=(len+chunk_len-1)/chunk_len;
+  std::vector<covariance_accumulator<T, DIM>> partial(chunks);
+  std::vector<work_stealing_pool::task_type> tasks;
+  for(size_t c=0; c<chunks; c++) {
+    tasks.push_back([&src, &partial, c, chunk_len, len](unsigned) {
+      size_t e=std::min(len, (c+1)*chunk_len);
+      npoint<T, DIM> x;
+      for(size_t i=c*chunk_len; i<e; i++) {
+        x=src(i).template cast<T>();
+        partial[c].add(x);
+      }
+    });
+  }
+  if(chunks>1) {
+    work_stealing_pool pool(threads);
+    pool.run(tasks);
+  }
+  else if(chunks) {
+    tasks[0](0);
+  }
+  for(size_t step=1; step<chunks; step*=2) {
+    for(size_t c=0; c+step<chunks; c+=2*step) {
+      partial[c].merge(partial[c+step]);
+    }
+  }
+  return chunks ? partial[0] : covariance_accumulator<T, DIM>();
+}
+
+// The Mahalanobis distance against the covariance of the points of a Supplier
+// (`size()`, `operator()(size_t i) const` with a result assignable to
+// `npoint<internal_type,DIM>`): the L2 distance between the points whitened
+// by the inverse of the Cholesky factor of the covariance.
+// The whitening is set up once by `update()`, after which the calculator is
+// immutable and safe to share between threads. The engines (see proc.hpp)
+// whiten all the points up front and go the L2 way.
 template <
   typename Coord, size_t DIM, class Supplier,
   typename internal_type=double
 >
 class mahalanobis {
 public:
-  mahalanobis() : supplier_(nullptr), dirty_(false), covar_inv_(), means_()
+  using matrix_type=Eigen::Matrix<internal_type, DIM, DIM>;
+
+  // `threads` - for the covariance computation, 0 - as many as the hardware supports
+  explicit mahalanobis(unsigned threads=0) : threads_(threads), means_(), whitening_()
   {
-    this->covar_inv_.setIdentity();
     this->means_.setZero();
+    this->whitening_.setIdentity();
   }
 
   void update(const Supplier* src) {
     if( src ) {
-      this->supplier_=src;
-      this->dirty_=true;
+      this->computeWhitening(*src);
     }
   }
 
   Coord operator()(const npoint<Coord, DIM> &p0, const npoint<Coord, DIM> &p1) const {
-    if(this->dirty_) {
-      this->computeMatrix();
+    return std::sqrt(this->squared(p0, p1));
+  }
+
+  Coord squared(const npoint<Coord, DIM> &p0, const npoint<Coord, DIM> &p1) const {
+    point_type diff=(p0-p1).template cast<internal_type>()*this->whitening_;
+    return static_cast<Coord>(diff.squaredNorm());
+  }
+
+  // the point in the space where this distance is the L2 one
+  npoint<Coord, DIM> whiten(const npoint<Coord, DIM>& p) const {
+    point_type centred=p.template cast<internal_type>()-this->means_;
+    return (centred*this->whitening_).template cast<Coord>();
+  }
+
+  // whitens all the points of `src` into `dest`
+  template <class Src> void whiten(const Src& src, soa_points<Coord, DIM>& dest) const {
+    size_t len=src.size();
+    dest.clear();
+    dest.reserve(len);
+    for(size_t i=0; i<len; i++) {
+      dest.push_back(this->whiten(src(i)));
     }
-    point_type diff=p0-p1;
-    Coord ret=std::sqrt((diff*this->covar_inv_)*diff.transpose());
-    return ret;
+  }
+
+  // W, with p*W the whitened (row) point p
+  const matrix_type& whitening() const {
+    return this->whitening_;
   }
 
 private:
   using point_type=npoint<internal_type, DIM>;
-  using matrix_type=Eigen::Matrix<internal_type, DIM, DIM>;
-  const Supplier* supplier_;
-  mutable bool dirty_;
-  mutable matrix_type covar_inv_;
-  mutable point_type  means_;
-
-  void computeMatrix() const {
-    static std::mt19937 rng;
-    static bool rngInited=false;
-
-    if(this->supplier_ && this->supplier_->size()>1) {
-      point_type sample0;
-      size_t len=this->supplier_->size();
-
-      means_.setZero();
-      point_type sample;
-      for(size_t i=0; i<len; i++) {
-        sample=(*supplier_)(i);
-        means_+=sample;
-      }
-      means_ /= static_cast<internal_type>(len);
-
-      point_type variance;
-      matrix_type covariance;
-      covariance.setZero();
-
-      for(size_t i=0; i<len; i++) {
-        sample=(*supplier_)(i);
-        variance=sample0-means_;
-        for(size_t r=0; r<DIM; r++) {
-          for(size_t c=r; c<DIM; c++) {
-            covariance(r,c)+=variance(r)*variance(c);
-          }
-        }
-      }
-      covariance/=internal_type(len-1);
-      //    for(size_t i=DIM-1; i<DIM; i--) {
-      //      for(size_t j=0; j<i; j++) {
-      //        covariance(i,j)=covariance(j, i);
-      //      }
-      //    }
-      matrix_type identity;
-      identity.setIdentity();
-      this->covar_inv_=
-        covariance.template selfadjointView<Eigen::Upper>()
-                   .ldlt()
-                   .solve(identity)
+
+  void computeWhitening(const Supplier& src) {
+    covariance_accumulator<internal_type, DIM> acc=
+      accumulate_covariance<internal_type, DIM>(src, this->threads_)
+    ;
+    this->means_=acc.mean;
+    this->whitening_.setIdentity();
+    if(acc.count>1) {
+      // covariance=L*L^T, so that d^T*covariance^-1*d=|L^-1*d|^2
+      matrix_type covar=acc.covariance();
+      Eigen::LLT<matrix_type> cholesky(covar);
+      // the rounding may leave a tiny positive pivot for a singular covariance
+      internal_type minPivot=
+        std::numeric_limits<internal_type>::epsilon()*covar.diagonal().maxCoeff()*DIM
       ;
-      // std::cout << this->covar_inv_ << std::endl;
-    }
-    else { // degrade to identity
-      this->covar_inv_.setIdentity();
-      if(1==this->supplier_->size()) {
-        this->supplier_->copy(0, this->means_);
-      }
-      else {
-        this->means_.setZero();
+      if(
+           Eigen::Success==cholesky.info()
+        && (cholesky.matrixL().toDenseMatrix().diagonal().array().square()>minPivot).all()
+      ) {
+        matrix_type identity=matrix_type::Identity();
+        matrix_type invL=cholesky.matrixL().solve(identity);
+        this->whitening_=invL.transpose();
       }
+      // else degenerate (e.g. collinear points), degrades to L2 on the centred points
     }
   }
+
+  unsigned threads_;
+  point_type means_;
+  matrix_type whitening_;
 };
 
 } // namespace distspctr
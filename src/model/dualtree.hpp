@@ -0,0 +1,309 @@
+/*
+ * File:   dualtree.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef DUALTREE_HPP
+#define DUALTREE_HPP
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "model.hpp"
+#include "rng.hpp"
+#include "simd.hpp"
+
+namespace distspctr {
+
+// k-d tree over a range of points: each node splits its points at the median
+// of the widest side of their bounding box. The tree keeps its own copy of the
+// points, in SoA layout and in node order, so that the points of any node are
+// contiguous coordinate columns.
+template <typename C, size_t DIM=2>
+class kd_tree {
+public:
+  using point_type=npoint<C,DIM>;
+
+  struct node {
+    point_type lo, hi;      // bounding box
+    size_t begin, end;      // points, as positions in points()
+    size_t left, right;     // children, 0 for the leaves (0 being the root)
+
+    size_t size() const {
+      return this->end-this->begin;
+    }
+
+    bool leaf() const {
+      return 0==this->left;
+    }
+  };
+
+  kd_tree() : points_(), nodes_() { }
+
+  // the points [begin, end) of `src` (`operator()(size_t) const`), nodes
+  // holding at most `leaf_len` of them
+  template <class Supplier>
+  kd_tree(const Supplier& src, size_t begin, size_t end, size_t leaf_len=32) :
+    points_(), nodes_()
+  {
+    size_t len=end-begin;
+    if(0==len) {
+      return;
+    }
+    std::vector<point_type> pts;
+    pts.reserve(len);
+    for(size_t i=begin; i<end; i++) {
+      pts.push_back(src(i));
+    }
+    this->nodes_.reserve(2*(len/std::max(leaf_len, size_t(1)))+1);
+    this->build(pts, 0, len, std::max(leaf_len, size_t(1)));
+    this->points_.reserve(len);
+    for(const point_type& p : pts) {
+      this->points_.push_back(p);
+    }
+  }
+
+  bool empty() const {
+    return this->nodes_.empty();
+  }
+
+  const node& root() const {
+    return this->nodes_[0];
+  }
+
+  const node& at(size_t ix) const {
+    return this->nodes_[ix];
+  }
+
+  const soa_points<C, DIM>& points() const {
+    return this->points_;
+  }
+
+private:
+  size_t build(std::vector<point_type>& pts, size_t b, size_t e, size_t leaf_len) {
+    node n;
+    n.begin=b; n.end=e; n.left=0; n.right=0;
+    n.lo=pts[b]; n.hi=pts[b];
+    for(size_t i=b+1; i<e; i++) {
+      n.lo=n.lo.cwiseMin(pts[i]);
+      n.hi=n.hi.cwiseMax(pts[i]);
+    }
+    size_t ix=this->nodes_.size();
+    this->nodes_.push_back(n);
+    if(e-b>leaf_len) {
+      size_t axis;
+      (n.hi-n.lo).maxCoeff(&axis);
+      if(n.hi(axis)>n.lo(axis)) { // otherwise all the points coincide
+        size_t mid=b+(e-b)/2;
+        std::nth_element(
+          pts.begin()+b, pts.begin()+mid, pts.begin()+e,
+          [axis](const point_type& p0, const point_type& p1) {
+            return p0(axis)<p1(axis);
+          }
+        );
+        size_t left=this->build(pts, b, mid, leaf_len);
+        size_t right=this->build(pts, mid, e, leaf_len);
+        this->nodes_[ix].left=left;
+        this->nodes_[ix].right=right;
+      }
+    }
+    return ix;
+  }
+
+  soa_points<C, DIM> points_;
+  std::vector<node> nodes_;
+};
+
+// Dual-tree L2 pair counting into a fixedl_histogram: a pair of nodes whose
+// distances (bounded by the distances between their bounding boxes) all land
+// in the same slot, or all above (or below) the histogram range, is counted in one go;
+// only the pairs straddling a slot boundary are split further, down to the
+// leaves, whose distances are computed as the batch l2 would.
+// The bounds are widened by the rounding error of the float distance
+// computation, so the counts are those of the pair by pair binning.
+template <typename C, size_t DIM=2>
+class dual_tree_counter {
+  // the leaves' distances go into the histogram through a row_chunks
+  struct adder {
+    fixedl_histogram<C>* dest;
+
+    void operator()(const C* sqVals, size_t count) const {
+      this->dest->add_squared_samples(sqVals, count);
+    }
+  };
+  using chunks_type=row_chunks<C, adder>;
+
+public:
+  using tree_type=kd_tree<C, DIM>;
+  using node_type=typename tree_type::node;
+
+  explicit dual_tree_counter(fixedl_histogram<C>& dest) :
+    dest_(dest), buffer_(), bin_seconds_(0)
+  {
+  }
+
+  // The pairs i<j within the node; returns their number
+  size_t count(const tree_type& tree, const node_type& a) {
+    chunks_type chunks(this->buffer_, adder{&this->dest_});
+    size_t ret=this->count(tree, a, chunks);
+    this->bin_seconds_=chunks.flush();
+    return ret;
+  }
+
+  // All the pairs across the two nodes; returns their number
+  size_t count(const tree_type& ta, const node_type& a, const tree_type& tb, const node_type& b) {
+    chunks_type chunks(this->buffer_, adder{&this->dest_});
+    size_t ret=this->count(ta, a, tb, b, chunks);
+    this->bin_seconds_=chunks.flush();
+    return ret;
+  }
+
+  // of the last count(): the time spent binning the distances of the leaves
+  double bin_seconds() const {
+    return this->bin_seconds_;
+  }
+
+private:
+  size_t count(const tree_type& tree, const node_type& a, chunks_type& chunks) {
+    size_t n=a.size();
+    size_t ret=triangle_pairs(n);
+    if(ret<2 || !this->resolve(a, a, ret)) {
+      if(a.leaf()) {
+        this->brute(tree, a, tree, a, true, chunks);
+      }
+      else {
+        const node_type& l=tree.at(a.left);
+        const node_type& r=tree.at(a.right);
+        this->count(tree, l, chunks);
+        this->count(tree, r, chunks);
+        this->count(tree, l, tree, r, chunks);
+      }
+    }
+    return ret;
+  }
+
+  size_t count(
+    const tree_type& ta, const node_type& a, const tree_type& tb, const node_type& b,
+    chunks_type& chunks
+  ) {
+    size_t ret=a.size()*b.size();
+    if(!this->resolve(a, b, ret)) {
+      if(a.leaf() && b.leaf()) {
+        this->brute(ta, a, tb, b, false, chunks);
+      }
+      else if(b.leaf() || (!a.leaf() && a.size()>=b.size())) {
+        this->count(ta, ta.at(a.left), tb, b, chunks);
+        this->count(ta, ta.at(a.right), tb, b, chunks);
+      }
+      else {
+        this->count(ta, a, tb, tb.at(b.left), chunks);
+        this->count(ta, a, tb, tb.at(b.right), chunks);
+      }
+    }
+    return ret;
+  }
+
+  // Counts the `pairs` of the nodes if they all land together
+  bool resolve(const node_type& a, const node_type& b, size_t pairs) {
+    long double lo=0, hi=0;
+    for(size_t d=0; d<DIM; d++) {
+      long double gap=std::max(
+        static_cast<long double>(a.lo(d))-b.hi(d), static_cast<long double>(b.lo(d))-a.hi(d)
+      );
+      long double span=std::max(
+        static_cast<long double>(a.hi(d))-b.lo(d), static_cast<long double>(b.hi(d))-a.lo(d)
+      );
+      if(gap>0) {
+        lo+=gap*gap;
+      }
+      hi+=span*span;
+    }
+    // each coordinate difference, square and sum rounds once (relatively)
+    const long double margin=4*(DIM+1)*static_cast<long double>(std::numeric_limits<C>::epsilon());
+    C sqLo=static_cast<C>(lo*(1-margin));
+    C sqHi=static_cast<C>(hi*(1+margin));
+    sqLo=std::nextafter(sqLo, C(0));
+    sqHi=std::nextafter(sqHi, std::numeric_limits<C>::infinity());
+    size_t slotLo=0, slotHi=0;
+    int whereLo=this->dest_.locate_squared(sqLo, slotLo);
+    int whereHi=this->dest_.locate_squared(sqHi, slotHi);
+    if(whereLo!=whereHi) {
+      return false;
+    }
+    if(0==whereLo) {
+      if(slotLo!=slotHi) {
+        return false;
+      }
+      this->dest_.add_to_slot(slotLo, pairs);
+    }
+    else if(whereLo>0) {
+      this->dest_.add_overflow(pairs);
+    }
+    // else all below the range, dropped
+    return true;
+  }
+
+  void brute(
+    const tree_type& ta, const node_type& a, const tree_type& tb, const node_type& b,
+    bool triangle, chunks_type& chunks
+  ) {
+    const soa_points<C, DIM>& pa=ta.points();
+    const soa_points<C, DIM>& pb=tb.points();
+    const C* cols[DIM];
+    for(size_t i=a.begin; i<a.end; i++) {
+      npoint<C,DIM> first=pa(i);
+      size_t jFrom=triangle ? i+1 : b.begin;
+      size_t count=b.end-jFrom;
+      for(size_t d=0; d<DIM; d++) {
+        cols[d]=pb.coords(d)+jFrom;
+      }
+      simd::l2_batch<C, DIM, false>(first.data(), cols, count, chunks.row(count));
+    }
+  }
+
+  fixedl_histogram<C>& dest_;
+  std::vector<C> buffer_;
+  double bin_seconds_;
+};
+
+// The leaf length of a kd_tree over the points [begin, end) of `src`, for
+// counting into `dest`. A node pair only gets counted in one go when both
+// nodes are narrower than a slot; with fewer than some 64 points expected in
+// a slot-wide box (of the points' bounding box) hardly any node pair does,
+// leaves as long as the tiled computation's tiles then have their pairs
+// computed at its rate.
+// Small leaves otherwise, to resolve as many node pairs as possible.
+template <typename C, size_t DIM, class Supplier>
+size_t dual_tree_leaf_len(
+  const Supplier& src, size_t begin, size_t end, const fixedl_histogram<C>& dest
+) {
+  if(end<=begin) {
+    return 1;
+  }
+  npoint<C,DIM> lo=src(begin), hi=lo;
+  for(size_t i=begin+1; i<end; i++) {
+    npoint<C,DIM> p=src(i);
+    lo=lo.cwiseMin(p);
+    hi=hi.cwiseMax(p);
+  }
+  long double width=
+      (static_cast<long double>(dest.max_sample_value())-dest.min_sample_value())
+    / std::max(dest.num_slots(), size_t(1))
+  ;
+  long double expected=end-begin;
+  for(size_t d=0; d<DIM; d++) {
+    long double extent=static_cast<long double>(hi(d))-lo(d);
+    if(extent>width) {
+      expected*=width/extent;
+    }
+  }
+  return expected>=64 ? 8 : 512;
+}
+
+} // namespace distspctr
+
+#endif /* DUALTREE_HPP */
@@ -0,0 +1,204 @@
+/*
+ * File:   gridfft.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef GRIDFFT_HPP
+#define GRIDFFT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include <unsupported/Eigen/FFT>
+
+#include "model.hpp"
+#include "workpool.hpp"
+
+namespace distspctr {
+
+// Approximate L2 distance counting for (planar) point sets of any size: the
+// points are rasterized onto a `grid_len` x `grid_len` grid of cells over a
+// box, the count of the pairs at every displacement (in cells) is the
+// correlation of the two count grids, computed by real FFTs over a grid padded
+// to twice the size (no wrap-around). Every displacement is then binned at the
+// distance between the cell centres.
+// Cost: O(points + grid_len^2 log(grid_len)) per range, whatever the number of points.
+// Error bound: rasterizing moves a point by at most half a cell on each axis, so
+// every distance is counted at most `max_error()` (the cell diagonal) away from
+// its true value. For any r, the counts up to r are between the exact ones up
+// to r-max_error() and up to r+max_error() (up to the FFT rounding, negligible
+// for less than ~2^40 pairs). Keep the cell diagonal well below the slot width.
+template <typename C>
+class grid_correlator {
+public:
+  using point_type=npoint<C, 2>;
+  using complex_type=std::complex<double>;
+  using spectrum_type=std::vector<complex_type>;
+
+  // the box [lo, hi], cells per side
+  grid_correlator(const point_type& lo, const point_type& hi, size_t grid_len=1024, unsigned threads=0) :
+    lo_(lo), cell_(), inv_cell_(), grid_len_(std::max(grid_len, size_t(1))), padded_(1),
+    threads_(threads)
+  {
+    while(this->padded_<2*this->grid_len_) {
+      this->padded_*=2;
+    }
+    for(size_t d=0; d<2; d++) {
+      long double side=static_cast<long double>(hi(d))-lo(d);
+      this->cell_[d]=side>0 ? side/this->grid_len_ : 0;
+      this->inv_cell_[d]=side>0 ? 1/this->cell_[d] : 0;
+    }
+  }
+
+  // the farthest a distance gets counted from its true value
+  double max_error() const {
+    return std::sqrt(this->cell_[0]*this->cell_[0]+this->cell_[1]*this->cell_[1]);
+  }
+
+  // The spectrum of the count grid of the points [begin, end) of `src`
+  // (`operator()(size_t) const`); the points out of the box are clamped onto it
+  template <class Supplier>
+  std::shared_ptr<spectrum_type> spectrum(const Supplier& src, size_t begin, size_t end) const {
+    size_t m=this->padded_, half=m/2+1;
+    std::vector<double> counts(this->grid_len_*m, 0.0);
+    for(size_t i=begin; i<end; i++) {
+      point_type p=src(i);
+      counts[this->cell(p, 1)*m+this->cell(p, 0)]+=1;
+    }
+    std::shared_ptr<spectrum_type> ret=std::make_shared<spectrum_type>(m*half);
+    spectrum_type& dest=*ret;
+    // the rows of points; the rows of the padding transform to zero
+    this->parallel(this->grid_len_, [&](Eigen::FFT<double>& fft, size_t y, std::vector<complex_type>&) {
+      fft.fwd(dest.data()+y*half, counts.data()+y*m, static_cast<Eigen::DenseIndex>(m));
+    });
+    this->columns(dest, true);
+    return ret;
+  }
+
+  // The number of pairs (one point from each range) at every displacement
+  // (dx, dy) in cells from the first to the second point, given the spectra of
+  // the two ranges; laid out as in `pairs_at`
+  void correlate(const spectrum_type& first, const spectrum_type& second, std::vector<double>& dest) const {
+    size_t m=this->padded_, half=m/2+1;
+    spectrum_type product(m*half);
+    for(size_t i=0; i<product.size(); i++) {
+      product[i]=std::conj(first[i])*second[i];
+    }
+    this->columns(product, false);
+    dest.assign(m*m, 0.0);
+    this->parallel(m, [&](Eigen::FFT<double>& fft, size_t y, std::vector<complex_type>&) {
+      fft.inv(dest.data()+y*m, product.data()+y*half, static_cast<Eigen::DenseIndex>(m));
+    });
+  }
+
+  // The correlation count at (dx, dy), both in (-grid_len, grid_len)
+  double pairs_at(const std::vector<double>& corr, long dx, long dy) const {
+    long m=static_cast<long>(this->padded_);
+    size_t x=static_cast<size_t>(dx<0 ? dx+m : dx), y=static_cast<size_t>(dy<0 ? dy+m : dy);
+    return corr[y*this->padded_+x];
+  }
+
+  // Adds the pairs of a correlation to `dest`: all of them if `intra` is false,
+  // otherwise (the correlation of a range with itself, of `points` points)
+  // only the i<j ones.
+  void bin(const std::vector<double>& corr, bool intra, size_t points, fixedl_histogram<C>& dest) const {
+    long g=static_cast<long>(this->grid_len_);
+    for(long dy=(intra ? 0 : 1-g); dy<g; dy++) {
+      for(long dx=1-g; dx<g; dx++) {
+        long double count=std::llround(this->pairs_at(corr, dx, dy));
+        if(intra) {
+          if(0==dy && dx<0) {
+            continue; // the same pairs as at (-dx, 0)
+          }
+          if(0==dy && 0==dx) {
+            // the points with themselves plus both orders of the same-cell pairs
+            count=(count-points)/2;
+          }
+        }
+        if(count<=0) {
+          continue;
+        }
+        long double x=dx*static_cast<long double>(this->cell_[0]);
+        long double y=dy*static_cast<long double>(this->cell_[1]);
+        size_t slot;
+        int where=dest.locate_squared(static_cast<C>(x*x+y*y), slot);
+        if(0==where) {
+          dest.add_to_slot(slot, static_cast<size_t>(count));
+        }
+        else if(where>0) {
+          dest.add_overflow(static_cast<size_t>(count));
+        }
+      }
+    }
+  }
+
+private:
+  size_t cell(const point_type& p, size_t d) const {
+    double pos=(static_cast<double>(p(d))-this->lo_(d))*this->inv_cell_[d];
+    if(!(pos>0)) {
+      return 0;
+    }
+    size_t ret=static_cast<size_t>(pos);
+    return std::min(ret, this->grid_len_-1);
+  }
+
+  // the FFT of each column of a half-spectrum laid out by rows
+  void columns(spectrum_type& data, bool forward) const {
+    size_t m=this->padded_, half=m/2+1;
+    this->parallel(half, [&](Eigen::FFT<double>& fft, size_t c, std::vector<complex_type>& buffer) {
+      buffer.resize(2*m);
+      complex_type* in=buffer.data();
+      complex_type* out=buffer.data()+m;
+      for(size_t y=0; y<m; y++) {
+        in[y]=data[y*half+c];
+      }
+      if(forward) {
+        fft.fwd(out, in, static_cast<Eigen::DenseIndex>(m));
+      }
+      else {
+        fft.inv(out, in, static_cast<Eigen::DenseIndex>(m));
+      }
+      for(size_t y=0; y<m; y++) {
+        data[y*half+c]=out[y];
+      }
+    });
+  }
+
+  // runs `line(fft, ix, buffer)` for ix in [0, count), in chunks over a
+  // work_stealing_pool; an FFT (with its plan cache) and a buffer per worker
+  template <class Line> void parallel(size_t count, Line line) const {
+    work_stealing_pool pool(this->threads_);
+    std::vector<Eigen::FFT<double>> ffts(pool.workers());
+    for(auto& fft : ffts) {
+      fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+    }
+    std::vector<std::vector<complex_type>> buffers(pool.workers());
+    const size_t chunk=64;
+    std::vector<work_stealing_pool::task_type> tasks;
+    for(size_t b=0; b<count; b+=chunk) {
+      size_t e=std::min(count, b+chunk);
+      tasks.push_back([&ffts, &buffers, &line, b, e](unsigned worker) {
+        for(size_t ix=b; ix<e; ix++) {
+          line(ffts[worker], ix, buffers[worker]);
+        }
+      });
+    }
+    pool.run(tasks);
+  }
+
+  point_type lo_;
+  double cell_[2];
+  double inv_cell_[2];
+  size_t grid_len_;
+  size_t padded_;
+  unsigned threads_;
+};
+
+} // namespace distspctr
+
+#endif /* GRIDFFT_HPP */
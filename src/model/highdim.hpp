@@ -0,0 +1,175 @@
+/*
+ * File:   highdim.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef HIGHDIM_HPP
+#define HIGHDIM_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "model.hpp"
+
+namespace distspctr {
+
+// Points of a dimension known only at runtime (e.g. embedding vectors), as
+// the rows of a contiguous row-major matrix
+template <typename C>
+class dense_points {
+public:
+  using matrix_type=Eigen::Matrix<C, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  dense_points() : coords_() { }
+
+  // `count` points at the origin
+  dense_points(size_t count, size_t dim) : coords_(matrix_type::Zero(count, dim))
+  {
+  }
+
+  // a copy of `count` points of `dim` coordinates, laid out one after the other
+  dense_points(const C* rows, size_t count, size_t dim) :
+    coords_(Eigen::Map<const matrix_type>(rows, count, dim))
+  {
+  }
+
+  size_t size() const {
+    return static_cast<size_t>(this->coords_.rows());
+  }
+
+  size_t dim() const {
+    return static_cast<size_t>(this->coords_.cols());
+  }
+
+  // the `dim()` coordinates of the i-th point
+  const C* row(size_t i) const {
+    return this->coords_.data()+i*this->dim();
+  }
+
+  C* row(size_t i) {
+    return this->coords_.data()+i*this->dim();
+  }
+
+  const matrix_type& matrix() const {
+    return this->coords_;
+  }
+
+  // of the bounding box of the points
+  C diag_len() const {
+    if(0==this->size()) {
+      return 0;
+    }
+    return (this->coords_.colwise().maxCoeff()-this->coords_.colwise().minCoeff()).norm();
+  }
+
+private:
+  matrix_type coords_;
+};
+
+// Squared L2 distances of dense_points, a tile of pairs at a time, through
+// |a-b|^2 = |a|^2+|b|^2-2a.b: the dot products of the tile are one matrix
+// product (Eigen's blocked GEMM), the norms are computed once.
+// The formulation loses precision to cancellation, so the value of a pair is
+// trusted only when the whole of its error bound bins the same; the others
+// (the pairs close to a slot boundary) are recomputed directly, as the sum of
+// the squared coordinate differences. The counts are those of binning the
+// direct form pair by pair.
+// The product form works on a copy of the points centred on their mean (the
+// distances don't change): the error bound grows with the norms, off-centre
+// points would send most of the pairs to the direct form.
+template <typename C>
+class gram_l2 {
+public:
+  using matrix_type=typename dense_points<C>::matrix_type;
+
+  explicit gram_l2(const dense_points<C>& points) :
+    points_(points), centred_(), norms_(points.size()), slack_(points.size())
+  {
+    if(points.size()) {
+      this->centred_=points.matrix().rowwise()-points.matrix().colwise().mean();
+    }
+    // both the product form and the direct one are within gamma(dim)*(|a|^2+|b|^2)
+    // of the true value (Higham, dot products; |a-b|^2<=2(|a|^2+|b|^2) for the
+    // direct one, wherever the origin), with a few roundings on top, the
+    // centring's included
+    const long double eps=std::numeric_limits<C>::epsilon();
+    const long double rel=(4*static_cast<long double>(points.dim())+24)*eps;
+    for(size_t i=0; i<points.size(); i++) {
+      this->norms_[i]=this->centred_.row(i).squaredNorm();
+      this->slack_[i]=static_cast<C>(rel*this->norms_[i]);
+    }
+  }
+
+  // the direct form, of the points as given
+  C squared(size_t i, size_t j) const {
+    const C* a=this->points_.row(i);
+    const C* b=this->points_.row(j);
+    C acc=0;
+    for(size_t d=0; d<this->points_.dim(); d++) {
+      C diff=b[d]-a[d];
+      acc+=diff*diff;
+    }
+    return acc;
+  }
+
+  // Bins the distances between the points [iBeg, iEnd) and [jBeg, jEnd), only
+  // the j>i ones if `triangle`, into `dest`; `gram` is scratch space.
+  // Returns the number of pairs, `binSeconds` the time spent binning them
+  // (everything past the matrix product).
+  size_t run(
+    size_t iBeg, size_t iEnd, size_t jBeg, size_t jEnd, bool triangle,
+    fixedl_histogram<C>& dest, matrix_type& gram, double& binSeconds
+  ) const {
+    size_t rows=iEnd-iBeg, cols=jEnd-jBeg;
+    gram.resize(rows, cols);
+    gram.noalias()=
+        this->centred_.middleRows(iBeg, rows)
+      * this->centred_.middleRows(jBeg, cols).transpose()
+    ;
+    auto binning=std::chrono::steady_clock::now();
+    size_t ret=0;
+    for(size_t r=0; r<rows; r++) {
+      size_t i=iBeg+r;
+      size_t cFrom=triangle ? (i+1>jBeg ? i+1-jBeg : 0) : 0;
+      const C* dots=gram.data()+r*cols;
+      for(size_t c=cFrom; c<cols; c++) {
+        size_t j=jBeg+c;
+        C sq=this->norms_[i]+this->norms_[j]-2*dots[c];
+        C slack=this->slack_[i]+this->slack_[j];
+        size_t slotLo=0, slotHi=0;
+        int whereLo=dest.locate_squared(std::max(sq-slack, C(0)), slotLo);
+        int whereHi=dest.locate_squared(sq+slack, slotHi);
+        if(whereLo!=whereHi || (0==whereLo && slotLo!=slotHi)) {
+          dest.fixedl_histogram<C>::add_squared_sample(this->squared(i, j));
+        }
+        else if(0==whereLo) {
+          dest.add_to_slot(slotLo, 1);
+        }
+        else if(whereLo>0) {
+          dest.add_overflow(1);
+        }
+        // else below the range, dropped
+      }
+      ret+=cols-cFrom;
+    }
+    binSeconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-binning).count();
+    return ret;
+  }
+
+private:
+  const dense_points<C>& points_;
+  matrix_type centred_;
+  std::vector<C> norms_;
+  std::vector<C> slack_;
+};
+
+} // namespace distspctr
+
+#endif /* HIGHDIM_HPP */
@@ -8,6 +8,7 @@
 #ifndef MODEL_HPP
 #define MODEL_HPP
 
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -143,17 +144,198 @@ private:
   const Transform* trn_;
 };
 
+// Structure-of-arrays storage of points: each of the DIM coordinates
+// is held in a contiguous column, the columns being `stride()` apart.
+// The stride is kept a multiple of `lane_pad` elements, so that all columns
+// share the (Eigen provided) alignment of the first.
+// Provides the `push_back(const npoint<C,DIM>&)` of the point containers
+// and the `size()`/`operator()(size_t)` of the point suppliers.
+template <typename C, size_t DIM=2>
+class soa_points {
+public:
+  using point_type=npoint<C,DIM>;
+
+  static constexpr size_t lane_pad=64/sizeof(C);
+
+  soa_points() : coords_(), size_(0) { }
+
+  void reserve(size_t capacity) {
+    capacity=(capacity+lane_pad-1)/lane_pad*lane_pad;
+    if(capacity>this->stride()) {
+      storage_type grown(capacity, DIM);
+      for(size_t d=0; d<DIM; d++) {
+        std::copy(this->coords(d), this->coords(d)+this->size_, grown.data()+d*capacity);
+      }
+      this->coords_.swap(grown);
+    }
+  }
+
+  void push_back(const point_type& p) {
+    if(this->size_==this->stride()) {
+      this->reserve(std::max(2*this->size_, lane_pad));
+    }
+    for(size_t d=0; d<DIM; d++) {
+      this->coords_(this->size_, d)=p(d);
+    }
+    this->size_++;
+  }
+
+  // appends the points [b, e) of `src`
+  void append(const soa_points<C, DIM>& src, size_t b, size_t e) {
+    size_t len=e-b;
+    this->reserve(this->size_+len);
+    for(size_t d=0; d<DIM; d++) {
+      std::copy(src.coords(d)+b, src.coords(d)+e, this->coords(d)+this->size_);
+    }
+    this->size_+=len;
+  }
+
+  // to `len` points, the added ones with unspecified coordinates
+  void resize(size_t len) {
+    this->reserve(len);
+    this->size_=len;
+  }
+
+  void clear() {
+    this->size_=0;
+  }
+
+  bool empty() const {
+    return 0==this->size_;
+  }
+
+  size_t size() const {
+    return this->size_;
+  }
+
+  size_t stride() const {
+    return static_cast<size_t>(this->coords_.rows());
+  }
+
+  point_type operator()(size_t i) const {
+    point_type ret;
+    for(size_t d=0; d<DIM; d++) {
+      ret(d)=this->coords_(i, d);
+    }
+    return ret;
+  }
+
+  // the column of the d-th coordinate
+  const C* coords(size_t d) const {
+    return this->coords_.data()+d*this->stride();
+  }
+
+  C* coords(size_t d) {
+    return this->coords_.data()+d*this->stride();
+  }
+
+private:
+  using storage_type=Eigen::Matrix<C, Eigen::Dynamic, DIM, Eigen::ColMajor>;
+  storage_type coords_;
+  size_t size_;
+};
+
+template <typename C, size_t DIM> constexpr size_t soa_points<C, DIM>::lane_pad;
+
+template <class Supplier, typename C, size_t DIM> class bound_npoint_cloud;
+
+// Immutable state of a bound_npoint_cloud, at a given version: the
+// (transformed) points of all the suppliers that are within bounds, in SoA
+// layout, those of each supplier in a contiguous range.
+// A point supplier itself (`size()`, `operator()(size_t)` and `coords(size_t)`)
+template <class Supplier, typename C, size_t DIM=2>
+class cloud_snapshot {
+public:
+  using point_type=npoint<C,DIM>;
+
+  cloud_snapshot() :
+    points_(), suppliers_(), supplier_versions_(), offsets_(1, 0), version_(0)
+  {
+  }
+
+  size_t size() const {
+    return this->points_.size();
+  }
+
+  point_type operator()(size_t i) const {
+    return this->points_(i);
+  }
+
+  const C* coords(size_t d) const {
+    return this->points_.coords(d);
+  }
+
+  const soa_points<C, DIM>& points() const {
+    return this->points_;
+  }
+
+  // increases with every change of the cloud
+  unsigned long long version() const {
+    return this->version_;
+  }
+
+  size_t supplier_count() const {
+    return this->suppliers_.size();
+  }
+
+  const Supplier* supplier(size_t ix) const {
+    return this->suppliers_.at(ix);
+  }
+
+  // supplier_count() if not in the snapshot
+  size_t index_of(const Supplier* supplier) const {
+    size_t len=this->suppliers_.size();
+    for(size_t i=0; i<len; i++) {
+      if(this->suppliers_[i]==supplier) {
+        return i;
+      }
+    }
+    return len;
+  }
+
+  // the version of the snapshot the points of the ix-th supplier were last read in
+  unsigned long long supplier_version(size_t ix) const {
+    return this->supplier_versions_.at(ix);
+  }
+
+  // the points of the ix-th supplier are in [begin_of(ix), end_of(ix))
+  size_t begin_of(size_t ix) const {
+    return this->offsets_.at(ix);
+  }
+
+  size_t end_of(size_t ix) const {
+    return this->offsets_.at(ix+1);
+  }
+
+private:
+  friend class bound_npoint_cloud<Supplier, C, DIM>;
+
+  soa_points<C, DIM> points_;
+  std::vector<const Supplier*> suppliers_;
+  std::vector<unsigned long long> supplier_versions_;
+  std::vector<size_t> offsets_;
+  unsigned long long version_;
+};
+
 // The supplier class is expected to provide:
 // - a `size_t size() const` method
 // - a `npoint<C,DIM> operator(size_t i) const`, returning a copy
 //   of the point stored at position `i`
+// The points of the suppliers are read (and filtered) only when a supplier is
+// added or `invalidate`-d, into a new snapshot; in between, the readers share
+// the current snapshot.
 template <
   class Supplier,
   typename C, size_t DIM=2
 >
 class bound_npoint_cloud {
 public:
-  bound_npoint_cloud() = default;
+  using snapshot_type=cloud_snapshot<Supplier, C, DIM>;
+
+  bound_npoint_cloud() :
+    suppliers_(), snapshot_(std::make_shared<snapshot_type>()), entries_lock_()
+  {
+  }
 
   virtual ~bound_npoint_cloud() = default;
 
@@ -163,6 +345,7 @@ public:
       if(this->index_of(supplier)>=this->suppliers_.size()) {
         // not already in
         this->suppliers_.push_back(supplier);
+        this->rebuild(supplier);
       }
     }
   }
@@ -173,6 +356,18 @@ public:
       size_t ix=this->index_of(supplier);
       if(ix<this->suppliers_.size()) {
         this->suppliers_.erase(this->suppliers_.begin()+ix);
+        this->rebuild(nullptr);
+      }
+    }
+  }
+
+  // to be called when the points of `supplier` changed: re-reads them
+  // into a new snapshot (the others are carried over from the current one)
+  void invalidate(const Supplier* supplier) {
+    if(supplier) {
+      std::unique_lock<std::mutex> barrier(this->entries_lock_);
+      if(this->index_of(supplier)<this->suppliers_.size()) {
+        this->rebuild(supplier);
       }
     }
   }
@@ -180,25 +375,20 @@ public:
   virtual bool within_bounds(const npoint<C,DIM>& p) const=0;
 
   size_t size() const {
-    size_t ret=0;
     std::unique_lock<std::mutex> barrier(this->entries_lock_);
-    for(auto e : this->suppliers_) {
-      for(size_t i=0; i<e->size(); i++) {
-        auto p=e->operator()(i);
-        if(this->within_bounds(p)) {
-          ret++;
-        }
-      }
-    }
-    return ret;
+    return this->snapshot_->size();
   }
 
+  std::shared_ptr<const snapshot_type> snapshot() const {
+    std::unique_lock<std::mutex> barrier(this->entries_lock_);
+    return this->snapshot_;
+  }
 
   // Container must provide `push_back(const npoint<C,DIM>&)` method
   template <typename Container> void points_copy(Container& dest) const {
-    std::unique_lock<std::mutex> barrier(this->entries_lock_);
-    for(auto const e : this->suppliers_) {
-      this->copy_supplier_points(e, dest);
+    std::shared_ptr<const snapshot_type> current=this->snapshot();
+    for(size_t i=0; i<current->size(); i++) {
+      dest.push_back((*current)(i));
     }
   }
 
@@ -207,10 +397,13 @@ public:
   void supplier_points(const Supplier* supplier, Container& dest) const
   {
     if(supplier) {
-      std::unique_lock<std::mutex> barrier(this->entries_lock_);
-      size_t ix=this->index_of(supplier);
-      auto const & e=this->suppliers_[ix];
-      this->copy_supplier_points(e, dest);
+      std::shared_ptr<const snapshot_type> current=this->snapshot();
+      size_t ix=current->index_of(supplier);
+      if(ix<current->supplier_count()) {
+        for(size_t i=current->begin_of(ix); i<current->end_of(ix); i++) {
+          dest.push_back((*current)(i));
+        }
+      }
     }
   }
 
@@ -247,9 +440,30 @@ protected:
     return size_t(-1);
   }
 
+  // with the entries_lock_ held
+  void rebuild(const Supplier* changed) {
+    const snapshot_type& prev=*this->snapshot_;
+    std::shared_ptr<snapshot_type> next=std::make_shared<snapshot_type>();
+    next->version_=prev.version_+1;
+    next->suppliers_=this->suppliers_;
+    for(auto e : this->suppliers_) {
+      size_t prevIx=prev.index_of(e);
+      if(e!=changed && prevIx<prev.supplier_count()) {
+        next->points_.append(prev.points_, prev.begin_of(prevIx), prev.end_of(prevIx));
+        next->supplier_versions_.push_back(prev.supplier_version(prevIx));
+      }
+      else {
+        this->copy_supplier_points(e, next->points_);
+        next->supplier_versions_.push_back(next->version_);
+      }
+      next->offsets_.push_back(next->points_.size());
+    }
+    this->snapshot_=next;
+  }
 
 private:
   std::vector<const Supplier*> suppliers_;
+  std::shared_ptr<const snapshot_type> snapshot_;
   mutable std::mutex entries_lock_;
 };
 
@@ -322,6 +536,12 @@ public:
   }
   
   virtual bool add_sample(const C& val)=0;
+
+  // `sqVal` is the square of a (non-negative) sample; histograms able to
+  // bin it in the squared domain spare the square root
+  virtual bool add_squared_sample(const C& sqVal) {
+    return this->add_sample(std::sqrt(sqVal));
+  }
   
   virtual C min_sample_value() const =0;
   
@@ -351,6 +571,11 @@ public:
   size_t slot_count(size_t slotIx) const {
     return this->buckets_.at(slotIx);
   }
+
+  // the samples above max_sample_value(): in total_count(), but in no slot
+  virtual size_t overflow_count() const {
+    return 0;
+  }
   
   virtual size_t total_count() const {
     size_t ret=0;
@@ -363,18 +588,44 @@ public:
   virtual void clear() {
     std::fill(this->buckets_.begin(), this->buckets_.end(), 0);
   }
+
+  // a histogram with the same slot layout as this, but no samples
+  virtual std::shared_ptr<histogram<C>> empty_clone() const=0;
+
+  // adds the samples counted by `other` to this; the two
+  // histograms are expected to share the same slot layout
+  virtual void merge(const histogram<C>& other) {
+    assert(other.num_slots()==this->num_slots());
+    for(size_t i=0; i<this->buckets_.size(); i++) {
+      this->buckets_[i]+=other.buckets_[i];
+    }
+  }
 };
 
 template <typename C>
 class fixedl_histogram : public histogram<C> {
   C min_;
   C max_;
-  size_t total_samples_;
+  size_t total_samples_; // overflow_ included
+  size_t overflow_;
   std::vector<C> thresholds_; // start value of the buckets in creasing order
+  // arithmetic lookup: the thresholds between -inf/+inf sentinels and
+  // the reciprocal of the slot width; used only if `uniform_`
+  bool uniform_;
+  C inv_delta_;
+  std::vector<C> guarded_;
+  // the squared domain: squares of the above, valid only if min_>=0
+  C sq_min_;
+  C sq_max_;
+  std::vector<C> sq_thresholds_;
+  bool sq_uniform_;
+  std::vector<C> sq_guarded_;
 public:
   fixedl_histogram(size_t slotCount, C min, C max) :
     histogram<C>(slotCount),
-    min_(min), max_(max), total_samples_(0), thresholds_(slotCount)
+    min_(min), max_(max), total_samples_(0), overflow_(0), thresholds_(slotCount),
+    uniform_(false), inv_delta_(), guarded_(),
+    sq_min_(), sq_max_(), sq_thresholds_(), sq_uniform_(false), sq_guarded_()
   {
     if(min_>max_) {
       std::swap(min_, max_);
@@ -383,6 +634,19 @@ public:
       long double x=static_cast<long double>(i)/slotCount;
       thresholds_[i]=static_cast<C>((1-x)*min_+x*max_);
     }
+    this->init_uniform_lookup();
+    if(min_>=0) {
+      // squaring is monotonic over non-negatives, so the slot
+      // a squared sample falls into can be searched among the squared thresholds
+      sq_min_=static_cast<C>(static_cast<long double>(min_)*min_);
+      sq_max_=static_cast<C>(static_cast<long double>(max_)*max_);
+      sq_thresholds_.resize(slotCount);
+      for(size_t i=0; i<slotCount; i++) {
+        long double t=thresholds_[i];
+        sq_thresholds_[i]=static_cast<C>(t*t);
+      }
+    }
+    this->init_squared_lookup();
   }
 
   fixedl_histogram(const fixedl_histogram& other) =default;
@@ -391,28 +655,77 @@ public:
     
   virtual ~fixedl_histogram() { }
   
+  // The samples below the range are dropped, the ones above it are counted
+  // as overflow (so that a histogram truncated to the short range
+  // values still knows the fractions of all the samples)
   virtual bool add_sample(const C& val) {
     bool ret=(val>=this->min_ && val<=this->max_);
     if(ret) {
-      // binary search the index of the bucket this sample should be counted against
-      size_t thrLen=this->thresholds_.size();
-      size_t b=0, e=thrLen-1;
-      while(b<=e && e<thrLen) { // e may underflow in e=mid-1
-        size_t mid=(b+e)/2;
-        if(val>this->thresholds_[mid]) {
-          b=mid+1;
-        }
-        else {
-          e=mid-1;
-        }
-      }
-       // count everything above the max against last bucket
-      b=(b>=thrLen-1) ? thrLen-1 : b;
-      this->buckets_[b]++;
+      this->buckets_[this->slot_index(val)]++;
       this->total_samples_++;
     }
+    else if(val>this->max_) {
+      this->add_overflow(1);
+    }
     return ret;
   }
+
+  virtual bool add_squared_sample(const C& sqVal) {
+    size_t slot;
+    int where=this->locate_squared(sqVal, slot);
+    if(0==where) {
+      this->buckets_[slot]++;
+      this->total_samples_++;
+    }
+    else if(where>0) {
+      this->add_overflow(1);
+    }
+    return 0==where;
+  }
+
+  // Same counts as add_sample/add_squared_sample for each of the `count`
+  // samples, for the engines handing over whole rows of distances
+  void add_samples(const C* vals, size_t count) {
+    for(size_t k=0; k<count; k++) {
+      this->fixedl_histogram::add_sample(vals[k]);
+    }
+  }
+
+  void add_squared_samples(const C* sqVals, size_t count) {
+    for(size_t k=0; k<count; k++) {
+      this->fixedl_histogram::add_squared_sample(sqVals[k]);
+    }
+  }
+
+  // Where add_squared_sample would count `sqVal`: -1 below the range,
+  // 1 above it, 0 within and `slotIx` set to the slot.
+  // Monotonic: a range of squared samples whose both ends locate
+  // the same lands all of it in the same place.
+  int locate_squared(C sqVal, size_t& slotIx) const {
+    if(this->sq_thresholds_.empty()) { // negative min, no squared domain
+      C val=std::sqrt(sqVal);
+      if(!(val>=this->min_)) {
+        return -1;
+      }
+      if(val>this->max_) {
+        return 1;
+      }
+      slotIx=this->slot_index(val);
+      return 0;
+    }
+    if(!(sqVal>=this->sq_min_)) {
+      return -1;
+    }
+    if(sqVal>this->sq_max_) {
+      return 1;
+    }
+    slotIx=
+        this->sq_uniform_
+      ? corrected_slot(sqVal, this->estimate_slot(std::sqrt(sqVal)), this->sq_guarded_)
+      : slot_of(this->sq_thresholds_, sqVal)
+    ;
+    return 0;
+  }
   
   virtual C min_sample_value() const {
     return this->min_;
@@ -425,12 +738,286 @@ public:
   virtual size_t total_count() const {
     return this->total_samples_;
   }
+
+  virtual size_t overflow_count() const {
+    return this->overflow_;
+  }
+
   virtual void clear() {
     histogram<C>::clear();
     this->total_samples_=0;
+    this->overflow_=0;
+  }
+
+  virtual std::shared_ptr<histogram<C>> empty_clone() const {
+    return std::make_shared<fixedl_histogram<C>>(this->num_slots(), this->min_, this->max_);
+  }
+
+  virtual void merge(const histogram<C>& other) {
+    histogram<C>::merge(other);
+    this->total_samples_+=other.total_count();
+    this->overflow_+=other.overflow_count();
+  }
+
+  // counts `count` samples known to fall into the slot
+  void add_to_slot(size_t slotIx, size_t count) {
+    this->buckets_.at(slotIx)+=count;
+    this->total_samples_+=count;
+  }
+
+  // counts `count` samples known to be above the range
+  void add_overflow(size_t count) {
+    this->overflow_+=count;
+    this->total_samples_+=count;
+  }
+
+  // The values counted against a slot: the first one takes only
+  // the min, the k-th one (t[k-1], t[k]], the last one (t[n-2], max].
+  // (slot_min/slot_max are the nominal bounds, for display)
+  void slot_range(size_t slotIx, long double& lo, long double& hi) const {
+    size_t len=this->thresholds_.size();
+    if(1==len) {
+      lo=this->min_; hi=this->max_;
+    }
+    else if(0==slotIx) {
+      lo=hi=this->min_;
+    }
+    else {
+      lo=this->thresholds_[slotIx-1];
+      hi=(slotIx+1<len) ? this->thresholds_[slotIx] : this->max_;
+    }
+  }
+
+  // Adds the samples of `src` as if each of them was multiplied by `factor`
+  // (e.g. the distances of a uniformly scaled point set). The samples are
+  // assumed evenly spread over their slot, the count of a source slot is
+  // split among the slots its scaled range overlaps in proportion to the
+  // overlap, then rounded so that the counts still add up. Whatever falls
+  // below min is dropped, above max goes to the overflow, same as the
+  // out-of-range samples. So does the overflow of `src`, which is exact
+  // only for a `factor` of at least max/src.max (in doubt, recompute).
+  // Each sample of `src` counts as `weight` samples (e.g. adding an
+  // exhaustive spectrum to one sampled at the `weight` rate).
+  // An approximation unless both are 1: the spread within a slot is not
+  // known, for previews rather than for final results.
+  void add_scaled(const fixedl_histogram<C>& src, C factor, long double weight=1) {
+    assert(factor>0 && weight>0);
+    if(1==factor && 1==weight) {
+      this->merge(src);
+      return;
+    }
+    size_t len=this->num_slots();
+    // the last one for the overflow
+    std::vector<long double> mass(len+1, 0.0);
+    mass[len]=weight*src.overflow_;
+    for(size_t k=0; k<src.num_slots(); k++) {
+      size_t count=src.buckets_[k];
+      if(!count) {
+        continue;
+      }
+      long double weighted=weight*count;
+      long double lo, hi;
+      src.slot_range(k, lo, hi);
+      lo*=factor; hi*=factor;
+      if(!(hi>lo)) { // all at the same value
+        if(lo>=this->min_ && lo<=this->max_) {
+          mass[this->slot_index(static_cast<C>(lo))]+=weighted;
+        }
+        else if(lo>this->max_) {
+          mass[len]+=weighted;
+        }
+        continue;
+      }
+      long double density=weighted/(hi-lo);
+      if(hi>this->max_) {
+        mass[len]+=density*(hi-std::max<long double>(lo, this->max_));
+      }
+      size_t j=(lo>this->min_) ? this->slot_index(static_cast<C>(std::min<long double>(lo, this->max_))) : 0;
+      for(; j<len; j++) {
+        long double tlo, thi;
+        this->slot_range(j, tlo, thi);
+        if(tlo>=hi) {
+          break;
+        }
+        long double overlap=std::min(hi, thi)-std::max(lo, tlo);
+        if(overlap>0) {
+          mass[j]+=density*overlap;
+        }
+      }
+    }
+    long double cumulated=0;
+    size_t assigned=0;
+    for(size_t j=0; j<=len; j++) {
+      cumulated+=mass[j];
+      size_t upTo=static_cast<size_t>(std::llround(cumulated));
+      if(j<len) {
+        this->add_to_slot(j, upTo-assigned);
+      }
+      else {
+        this->add_overflow(upTo-assigned);
+      }
+      assigned=upTo;
+    }
+  }
+
+private:
+  size_t slot_index(C val) const {
+    return
+        this->uniform_
+      ? corrected_slot(val, this->estimate_slot(val), this->guarded_)
+      : slot_of(this->thresholds_, val)
+    ;
+  }
+
+  // The slot estimate from the slot width is a monotonic function of the
+  // sample, the same as the binary search result. If, around every threshold,
+  // the two don't differ by more than one slot, they can't differ by more
+  // anywhere in between and a single correction step against the thresholds
+  // makes the estimate exact. Otherwise (rounding trouble, degenerate ranges),
+  // keep to the binary search.
+  void init_uniform_lookup() {
+    size_t thrLen=this->thresholds_.size();
+    this->uniform_=false;
+    if(!(this->max_>this->min_) || !std::numeric_limits<C>::has_infinity) {
+      return;
+    }
+    this->inv_delta_=static_cast<C>(thrLen/(static_cast<long double>(this->max_)-this->min_));
+    if(!std::isfinite(this->inv_delta_)) {
+      return;
+    }
+    auto linear=[this](C val) { return this->estimate_slot(val); };
+    this->uniform_=this->init_lookup(this->thresholds_, this->guarded_, linear);
+  }
+
+  // The squared thresholds aren't equally spaced, but the square root of
+  // a squared sample is as good an estimate as the sample itself; the
+  // correction step is done in the squared domain, so the result is the
+  // binary search one.
+  void init_squared_lookup() {
+    this->sq_uniform_=false;
+    if(this->uniform_ && !this->sq_thresholds_.empty()) {
+      auto root=[this](C sqVal) { return this->estimate_slot(std::sqrt(sqVal)); };
+      this->sq_uniform_=this->init_lookup(this->sq_thresholds_, this->sq_guarded_, root);
+    }
+  }
+
+  template <class Estimator> static bool init_lookup(
+    const std::vector<C>& thresholds, std::vector<C>& guarded, Estimator estimate
+  ) {
+    size_t thrLen=thresholds.size();
+    for(size_t i=1; i<thrLen; i++) {
+      if(!(thresholds[i-1]<thresholds[i])) {
+        return false;
+      }
+    }
+    guarded.resize(thrLen+2);
+    guarded[0]=-std::numeric_limits<C>::infinity();
+    std::copy(thresholds.begin(), thresholds.end(), guarded.begin()+1);
+    guarded[thrLen+1]=std::numeric_limits<C>::infinity();
+    for(size_t i=0; i<thrLen; i++) {
+      C at=thresholds[i];
+      C above=std::nextafter(at, std::numeric_limits<C>::infinity());
+      size_t atEstimate=estimate(at), aboveEstimate=estimate(above);
+      if(
+           atEstimate+1<i || atEstimate>i+1
+        || aboveEstimate<i || aboveEstimate>i+2
+      ) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // ceil((val-min)/delta), clamped to [0, num_slots()]
+  size_t estimate_slot(C val) const {
+    C x=std::ceil((val-this->min_)*this->inv_delta_);
+    x=std::min(std::max(x, C(0)), static_cast<C>(this->thresholds_.size()));
+    return static_cast<size_t>(x);
+  }
+
+  // Same result as `slot_of(thresholds, val)` if the estimate `k` is
+  // at most one slot off. With the sentinels, guarded[k] is the threshold
+  // below the k-th one.
+  static size_t corrected_slot(C val, size_t k, const std::vector<C>& guarded) {
+    const C* g=guarded.data();
+    k-=static_cast<size_t>(val<=g[k]);
+    k+=static_cast<size_t>(val>g[k+1]);
+    size_t last=guarded.size()-3;
+    return k>last ? last : k;
+  }
+
+  static size_t slot_of(const std::vector<C>& thresholds, C val) {
+    // binary search the index of the bucket this sample should be counted against
+    size_t thrLen=thresholds.size();
+    size_t b=0, e=thrLen-1;
+    while(b<=e && e<thrLen) { // e may underflow in e=mid-1
+      size_t mid=(b+e)/2;
+      if(val>thresholds[mid]) {
+        b=mid+1;
+      }
+      else {
+        e=mid-1;
+      }
+    }
+     // count everything above the max against last bucket
+    return (b>=thrLen-1) ? thrLen-1 : b;
   }
 };
 
+// Gathers rows of samples into chunks handed to `add` (a
+// `void(const C* vals, size_t count)`), for the engines telling the time
+// spent binning from that spent computing: one clock pair per chunk,
+// not per row. The chunks (1024 samples, unless a row is longer) stay
+// in L1 along with the histogram.
+template <typename C, class Add>
+class row_chunks {
+public:
+  row_chunks(std::vector<C>& buffer, Add add) :
+    buffer_(buffer), add_(add), used_(0), seconds_(0)
+  {
+    if(this->buffer_.size()<1024) {
+      this->buffer_.resize(1024);
+    }
+  }
+
+  // room for a row of `count` samples, valid until the next call
+  C* row(size_t count) {
+    if(this->used_+count>this->buffer_.size()) {
+      this->flush();
+      if(count>this->buffer_.size()) {
+        this->buffer_.resize(count);
+      }
+    }
+    C* ret=this->buffer_.data()+this->used_;
+    this->used_+=count;
+    return ret;
+  }
+
+  // adds the rows gathered so far; the seconds taken by all the adds
+  double flush() {
+    if(this->used_>0) {
+      auto start=std::chrono::steady_clock::now();
+      this->add_(this->buffer_.data(), this->used_);
+      this->used_=0;
+      this->seconds_+=
+        std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count()
+      ;
+    }
+    return this->seconds_;
+  }
+
+private:
+  std::vector<C>& buffer_;
+  Add add_;
+  size_t used_;
+  double seconds_;
+};
+
+template <typename C, class Add>
+row_chunks<C, Add> make_row_chunks(std::vector<C>& buffer, Add add) {
+  return row_chunks<C, Add>(buffer, add);
+}
+
 } // namespace distspctr
 
 #endif /* MODEL_HPP */
@@ -0,0 +1,439 @@
+/*
+ * File:   pointfile.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef POINTFILE_HPP
+#define POINTFILE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "model.hpp"
+
+namespace distspctr {
+
+// Binary point cloud container, version 1 (native byte order, as written):
+// - a 64 byte header (point_file_header);
+// - at `payload_offset` (64 byte aligned), the points in SoA layout: `dim`
+//   columns of `stride` scalars each (stride a multiple of 64 bytes), the
+//   d-th coordinate of the i-th point at column d, position i;
+// - at `clusters_offset`, if `cluster_count`: cluster_count+1 uint64 point
+//   offsets (the k-th cluster is the points [offset[k], offset[k+1])),
+//   followed by cluster_count double weights.
+// Made to be mapped in memory and read in place (see mapped_points).
+struct point_file_header {
+  static constexpr std::uint32_t current_version=1;
+  static constexpr std::uint32_t float32=1;
+  static constexpr std::uint32_t float64=2;
+
+  char magic[8];                // "DSPCLOUD"
+  std::uint32_t version;
+  std::uint32_t dim;
+  std::uint32_t scalar;         // float32 or float64
+  std::uint32_t cluster_count;  // 0 - no clusters
+  std::uint64_t count;          // of points
+  std::uint64_t stride;         // scalars per coordinate column
+  std::uint64_t payload_offset; // bytes from the start of the file
+  std::uint64_t clusters_offset;
+  std::uint8_t reserved[8];
+
+  template <typename C> static std::uint32_t scalar_of() {
+    static_assert(
+      std::is_same<C, float>::value || std::is_same<C, double>::value,
+      "only float and double coordinates"
+    );
+    return std::is_same<C, float>::value ? float32 : float64;
+  }
+
+  static const char* expected_magic() {
+    return "DSPCLOUD";
+  }
+};
+
+static_assert(sizeof(point_file_header)==64, "the header is 64 bytes");
+
+namespace detail {
+
+// Reads the header of a point file of `fileSize` bytes from `data` and checks
+// it against the coordinates expected; returns the end of the payload.
+// may throw() std::runtime_error
+template <typename C, size_t DIM>
+std::uint64_t read_point_file_header(
+  const std::string& path, const void* data, std::uint64_t fileSize, point_file_header& header
+) {
+  if(fileSize<sizeof(point_file_header)) {
+    throw std::runtime_error(path+": not a point file");
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if(0!=std::memcmp(header.magic, point_file_header::expected_magic(), sizeof(header.magic))) {
+    throw std::runtime_error(path+": not a point file");
+  }
+  if(point_file_header::current_version!=header.version) {
+    throw std::runtime_error(path+": unsupported version");
+  }
+  if(DIM!=header.dim || point_file_header::scalar_of<C>()!=header.scalar) {
+    throw std::runtime_error(path+": other dimension or coordinate type");
+  }
+  if(header.stride>fileSize/(DIM*sizeof(C))) {
+    throw std::runtime_error(path+": truncated or corrupt");
+  }
+  std::uint64_t payloadEnd=header.payload_offset+DIM*header.stride*sizeof(C);
+  if(
+       header.stride<header.count || 0!=header.payload_offset%64
+    || payloadEnd<header.payload_offset || payloadEnd>fileSize
+  ) {
+    throw std::runtime_error(path+": truncated or corrupt");
+  }
+  return payloadEnd;
+}
+
+} // namespace detail
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class mapped_file {
+public:
+  // may throw() std::runtime_error if the file can't be mapped
+  explicit mapped_file(const std::string& path) : data_(nullptr), size_(0)
+#if defined(_WIN32)
+    , file_(INVALID_HANDLE_VALUE), mapping_(nullptr)
+#endif
+  {
+#if defined(_WIN32)
+    this->file_=CreateFileA(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    LARGE_INTEGER len;
+    if(INVALID_HANDLE_VALUE==this->file_ || !GetFileSizeEx(this->file_, &len)) {
+      this->release();
+      throw std::runtime_error("can't open "+path);
+    }
+    this->size_=static_cast<size_t>(len.QuadPart);
+    if(this->size_) {
+      this->mapping_=CreateFileMappingA(this->file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if(this->mapping_) {
+        this->data_=MapViewOfFile(this->mapping_, FILE_MAP_READ, 0, 0, 0);
+      }
+    }
+#else
+    int fd=::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd<0 || 0!=::fstat(fd, &st)) {
+      if(fd>=0) {
+        ::close(fd);
+      }
+      throw std::runtime_error("can't open "+path);
+    }
+    this->size_=static_cast<size_t>(st.st_size);
+    if(this->size_) {
+      void* at=::mmap(nullptr, this->size_, PROT_READ, MAP_SHARED, fd, 0);
+      this->data_=(MAP_FAILED==at) ? nullptr : at;
+    }
+    ::close(fd); // the mapping stays
+#endif
+    if(this->size_ && !this->data_) {
+      this->release();
+      throw std::runtime_error("can't map "+path);
+    }
+  }
+
+  mapped_file(const mapped_file&)=delete;
+  mapped_file& operator=(const mapped_file&)=delete;
+
+  ~mapped_file() {
+    this->release();
+  }
+
+  const unsigned char* data() const {
+    return static_cast<const unsigned char*>(this->data_);
+  }
+
+  size_t size() const {
+    return this->size_;
+  }
+
+private:
+  void release() {
+#if defined(_WIN32)
+    if(this->data_) {
+      UnmapViewOfFile(this->data_);
+    }
+    if(this->mapping_) {
+      CloseHandle(this->mapping_);
+    }
+    if(INVALID_HANDLE_VALUE!=this->file_) {
+      CloseHandle(this->file_);
+    }
+    this->mapping_=nullptr;
+    this->file_=INVALID_HANDLE_VALUE;
+#else
+    if(this->data_) {
+      ::munmap(this->data_, this->size_);
+    }
+#endif
+    this->data_=nullptr;
+  }
+
+  void* data_;
+  size_t size_;
+#if defined(_WIN32)
+  HANDLE file_;
+  HANDLE mapping_;
+#endif
+};
+
+// The points of a point file (or of a range of them, e.g. a cluster), read
+// in place from its memory mapping: opening costs the header checks, no copy
+// of the points is ever made.
+// A point supplier (`size()`, `operator()(size_t)` and the `coords(size_t)`
+// of the batch kernels) and its own immutable `snapshot()`, so it goes as is
+// to the compute_distances_* engines, histogram_filler and (as a copy, like
+// any supplier) bound_npoint_cloud.
+template <typename C, size_t DIM=2>
+class mapped_points : public std::enable_shared_from_this<mapped_points<C, DIM>> {
+public:
+  using point_type=npoint<C,DIM>;
+
+  // may throw() std::runtime_error for the missing, truncated or otherwise
+  // not matching (DIM, scalar type) files
+  static std::shared_ptr<const mapped_points> open(const std::string& path) {
+    std::shared_ptr<const mapped_file> file=std::make_shared<mapped_file>(path);
+    point_file_header header;
+    std::uint64_t payloadEnd=
+      detail::read_point_file_header<C, DIM>(path, file->data(), file->size(), header)
+    ;
+    std::shared_ptr<mapped_points> ret(new mapped_points(file, header, 0, header.count));
+    if(header.cluster_count) {
+      // the offsets, then the weights
+      std::uint64_t tableLen=(2*std::uint64_t(header.cluster_count)+1)*sizeof(std::uint64_t);
+      if(
+           header.clusters_offset<payloadEnd || header.clusters_offset>file->size()
+        || tableLen>file->size()-header.clusters_offset
+      ) {
+        throw std::runtime_error(path+": truncated or corrupt");
+      }
+      const unsigned char* table=file->data()+header.clusters_offset;
+      ret->cluster_offsets_.resize(header.cluster_count+1);
+      ret->cluster_weights_.resize(header.cluster_count);
+      std::memcpy(ret->cluster_offsets_.data(), table, ret->cluster_offsets_.size()*sizeof(std::uint64_t));
+      std::memcpy(
+        ret->cluster_weights_.data(), table+ret->cluster_offsets_.size()*sizeof(std::uint64_t),
+        ret->cluster_weights_.size()*sizeof(double)
+      );
+      if(
+           0!=ret->cluster_offsets_.front() || header.count!=ret->cluster_offsets_.back()
+        || !std::is_sorted(ret->cluster_offsets_.begin(), ret->cluster_offsets_.end())
+      ) {
+        throw std::runtime_error(path+": corrupt cluster table");
+      }
+    }
+    return ret;
+  }
+
+  size_t size() const {
+    return this->count_;
+  }
+
+  point_type operator()(size_t i) const {
+    point_type ret;
+    for(size_t d=0; d<DIM; d++) {
+      ret(d)=this->columns_[d][i];
+    }
+    return ret;
+  }
+
+  // the column of the d-th coordinate, in the mapping
+  const C* coords(size_t d) const {
+    return this->columns_[d];
+  }
+
+  std::shared_ptr<const mapped_points> snapshot() const {
+    return this->shared_from_this();
+  }
+
+  // of the file; 0 for a cluster view
+  size_t cluster_count() const {
+    return this->cluster_weights_.size();
+  }
+
+  // the k-th cluster is [cluster_begin(k), cluster_end(k))
+  size_t cluster_begin(size_t k) const {
+    return static_cast<size_t>(this->cluster_offsets_.at(k));
+  }
+
+  size_t cluster_end(size_t k) const {
+    return static_cast<size_t>(this->cluster_offsets_.at(k+1));
+  }
+
+  double cluster_weight(size_t k) const {
+    return this->cluster_weights_.at(k);
+  }
+
+  // the points of the k-th cluster, sharing the mapping
+  std::shared_ptr<const mapped_points> cluster(size_t k) const {
+    return std::shared_ptr<const mapped_points>(
+      new mapped_points(*this, this->cluster_begin(k), this->cluster_end(k))
+    );
+  }
+
+private:
+  mapped_points(
+    const std::shared_ptr<const mapped_file>& file, const point_file_header& header,
+    size_t begin, size_t end
+  ) :
+    file_(file), columns_(), count_(end-begin), cluster_offsets_(), cluster_weights_()
+  {
+    const C* payload=reinterpret_cast<const C*>(file->data()+header.payload_offset);
+    for(size_t d=0; d<DIM; d++) {
+      this->columns_[d]=payload+d*header.stride+begin;
+    }
+  }
+
+  mapped_points(const mapped_points& whole, size_t begin, size_t end) :
+    std::enable_shared_from_this<mapped_points<C, DIM>>(),
+    file_(whole.file_), columns_(), count_(end-begin), cluster_offsets_(), cluster_weights_()
+  {
+    for(size_t d=0; d<DIM; d++) {
+      this->columns_[d]=whole.columns_[d]+begin;
+    }
+  }
+
+  std::shared_ptr<const mapped_file> file_;
+  const C* columns_[DIM];
+  size_t count_;
+  std::vector<std::uint64_t> cluster_offsets_;
+  std::vector<double> cluster_weights_;
+};
+
+// The points of a point file, read range by range into memory (for the files
+// too large to be kept in memory, see compute_distances_streamed): a
+// `BlockSource`. The reads go one at a time, from whichever thread.
+template <typename C, size_t DIM=2>
+class point_file_reader {
+public:
+  // may throw() std::runtime_error, as mapped_points::open
+  explicit point_file_reader(const std::string& path) :
+    path_(path), in_(path.c_str(), std::ios::binary), header_(), lock_()
+  {
+    if(!this->in_) {
+      throw std::runtime_error("can't open "+path);
+    }
+    this->in_.seekg(0, std::ios::end);
+    std::uint64_t fileSize=static_cast<std::uint64_t>(this->in_.tellg());
+    char head[sizeof(point_file_header)]={0};
+    this->in_.seekg(0);
+    this->in_.read(head, std::min<std::uint64_t>(fileSize, sizeof(head)));
+    detail::read_point_file_header<C, DIM>(path, head, fileSize, this->header_);
+  }
+
+  size_t size() const {
+    return static_cast<size_t>(this->header_.count);
+  }
+
+  // appends the points [begin, end) to `dest`
+  // may throw() std::runtime_error on a failed read
+  void read(size_t begin, size_t end, soa_points<C, DIM>& dest) {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    size_t at=dest.size(), len=end-begin;
+    dest.resize(at+len);
+    for(size_t d=0; d<DIM; d++) {
+      std::uint64_t offset=this->header_.payload_offset+(d*this->header_.stride+begin)*sizeof(C);
+      this->in_.seekg(static_cast<std::streamoff>(offset));
+      this->in_.read(reinterpret_cast<char*>(dest.coords(d)+at), static_cast<std::streamsize>(len*sizeof(C)));
+    }
+    if(!this->in_) {
+      this->in_.clear();
+      dest.resize(at);
+      throw std::runtime_error("can't read "+this->path_);
+    }
+  }
+
+private:
+  std::string path_;
+  std::ifstream in_;
+  point_file_header header_;
+  std::mutex lock_;
+};
+
+// Writes the points of `src` (`size()`, `operator()(size_t)`) as a point file,
+// a column at a time. `clusterOffsets` - empty, or the cluster boundaries
+// (from 0 up to src.size()); `weights` - one per cluster (1 if missing).
+// may throw() std::runtime_error if the file can't be written
+template <typename C, size_t DIM, class Supplier>
+void write_point_file(
+  const std::string& path, const Supplier& src,
+  const std::vector<std::uint64_t>& clusterOffsets=std::vector<std::uint64_t>(),
+  const std::vector<double>& weights=std::vector<double>()
+) {
+  const size_t pad=64/sizeof(C);
+  point_file_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, point_file_header::expected_magic(), sizeof(header.magic));
+  header.version=point_file_header::current_version;
+  header.dim=DIM;
+  header.scalar=point_file_header::scalar_of<C>();
+  header.count=src.size();
+  header.stride=(header.count+pad-1)/pad*pad;
+  header.payload_offset=sizeof(header);
+  header.cluster_count=
+      clusterOffsets.size()>1
+    ? static_cast<std::uint32_t>(clusterOffsets.size()-1)
+    : 0
+  ;
+  header.clusters_offset=
+      header.cluster_count
+    ? header.payload_offset+DIM*header.stride*sizeof(C)
+    : 0
+  ;
+
+  std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  std::vector<C> column;
+  for(size_t d=0; d<DIM && out; d++) {
+    column.assign(header.stride, C(0));
+    for(size_t i=0; i<header.count; i++) {
+      column[i]=src(i)(d);
+    }
+    out.write(reinterpret_cast<const char*>(column.data()), column.size()*sizeof(C));
+  }
+  if(header.cluster_count) {
+    out.write(
+      reinterpret_cast<const char*>(clusterOffsets.data()),
+      clusterOffsets.size()*sizeof(std::uint64_t)
+    );
+    for(size_t k=0; k<header.cluster_count; k++) {
+      double w=k<weights.size() ? weights[k] : 1.0;
+      out.write(reinterpret_cast<const char*>(&w), sizeof(w));
+    }
+  }
+  if(!out) {
+    throw std::runtime_error("can't write "+path);
+  }
+}
+
+} // namespace distspctr
+
+#endif /* POINTFILE_HPP */
@@ -9,18 +9,30 @@
 #ifndef PROC_HPP
 #define PROC_HPP
 
+#include <algorithm>
+#include <chrono>
 #include <limits>
+#include <map>
 #include <numeric>
 #include <random>
 #include <type_traits>
 #include <functional>
+#include <future>
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <mutex>
 
 #include <typeinfo>
 
 #include "model.hpp"
+#include "celllist.hpp"
+#include "dists.hpp"
+#include "dualtree.hpp"
+#include "gridfft.hpp"
+#include "highdim.hpp"
+#include "rng.hpp"
+#include "workpool.hpp"
 
 namespace distspctr {
 
@@ -97,128 +109,1698 @@ struct dist_type_updater
 };
 
 
+// SFINAE check for the batch form of a distance calculator:
+// `void operator()(const npoint<C,DIM>&, const C* const* cols, size_t count, C* dest) const`
+template <class dist_type, typename C, size_t DIM>
+struct is_batch_dist {
+private:
+  template <typename T>
+  static constexpr auto check(T*) ->
+    typename std::is_same<
+      decltype(
+        std::declval<const T&>()(
+          std::declval<const npoint<C,DIM>&>(), std::declval<const C* const*>(),
+          std::declval<size_t>(), std::declval<C*>()
+        )
+      ),
+      void
+    >::type;
+  template<typename>
+  static constexpr std::false_type check(...);
+
+  using response=decltype(check<dist_type>(static_cast<dist_type*>(nullptr)));
+public:
+  static constexpr bool value=response::value;
+};
+
+// SFINAE checks for the squared forms of a distance calculator
+// `C squared(const npoint<C,DIM>&, const npoint<C,DIM>&) const`
+template <class dist_type, typename C, size_t DIM>
+struct is_squared_dist {
+private:
+  template <typename T>
+  static constexpr auto check(T*) ->
+    typename std::is_convertible<
+      decltype(
+        std::declval<const T&>().squared(
+          std::declval<const npoint<C,DIM>&>(), std::declval<const npoint<C,DIM>&>()
+        )
+      ),
+      C
+    >::type;
+  template<typename>
+  static constexpr std::false_type check(...);
+
+  using response=decltype(check<dist_type>(static_cast<dist_type*>(nullptr)));
+public:
+  static constexpr bool value=response::value;
+};
+
+// `void squared(const npoint<C,DIM>&, const C* const* cols, size_t count, C* dest) const`
+template <class dist_type, typename C, size_t DIM>
+struct is_squared_batch_dist {
+private:
+  template <typename T>
+  static constexpr auto check(T*) ->
+    typename std::is_same<
+      decltype(
+        std::declval<const T&>().squared(
+          std::declval<const npoint<C,DIM>&>(), std::declval<const C* const*>(),
+          std::declval<size_t>(), std::declval<C*>()
+        )
+      ),
+      void
+    >::type;
+  template<typename>
+  static constexpr std::false_type check(...);
+
+  using response=decltype(check<dist_type>(static_cast<dist_type*>(nullptr)));
+public:
+  static constexpr bool value=response::value;
+};
+
+// SFINAE check for suppliers exposing their points as coordinate
+// columns (see soa_points): `const C* coords(size_t dim) const`
+template <class Supplier, typename C>
+struct is_soa_supplier {
+private:
+  template <typename T>
+  static constexpr auto check(T*) ->
+    typename std::is_same<
+      decltype(std::declval<const T&>().coords(std::declval<size_t>())),
+      const C*
+    >::type;
+  template<typename>
+  static constexpr std::false_type check(...);
+
+  using response=decltype(check<Supplier>(static_cast<Supplier*>(nullptr)));
+public:
+  static constexpr bool value=response::value;
+};
+
+// The binning calls into a histogram of the static type `Hist`: bound at
+// compile time (thus inlined into the kernels) for a concrete class, left
+// virtual for the abstract histogram<C>. The `_all` forms bin `count` values.
+template <typename C, class Hist, bool=std::is_abstract<Hist>::value>
+struct bin_calls {
+  static void add(Hist& dest, C val) {
+    dest.Hist::add_sample(val);
+  }
+
+  static void add_squared(Hist& dest, C sqVal) {
+    dest.Hist::add_squared_sample(sqVal);
+  }
+
+  static void add_all(Hist& dest, const C* vals, size_t count) {
+    for(size_t k=0; k<count; k++) {
+      dest.Hist::add_sample(vals[k]);
+    }
+  }
+
+  static void add_squared_all(Hist& dest, const C* sqVals, size_t count) {
+    for(size_t k=0; k<count; k++) {
+      dest.Hist::add_squared_sample(sqVals[k]);
+    }
+  }
+};
+
+template <typename C, class Hist>
+struct bin_calls<C, Hist, true> {
+  static void add(Hist& dest, C val) {
+    dest.add_sample(val);
+  }
+
+  static void add_squared(Hist& dest, C sqVal) {
+    dest.add_squared_sample(sqVal);
+  }
+
+  static void add_all(Hist& dest, const C* vals, size_t count) {
+    for(size_t k=0; k<count; k++) {
+      dest.add_sample(vals[k]);
+    }
+  }
+
+  static void add_squared_all(Hist& dest, const C* sqVals, size_t count) {
+    for(size_t k=0; k<count; k++) {
+      dest.add_squared_sample(sqVals[k]);
+    }
+  }
+};
+
+// ... the fixedl_histogram having bulk forms of its own
+template <typename C>
+struct bin_calls<C, fixedl_histogram<C>, false> {
+  static void add(fixedl_histogram<C>& dest, C val) {
+    dest.fixedl_histogram<C>::add_sample(val);
+  }
+
+  static void add_squared(fixedl_histogram<C>& dest, C sqVal) {
+    dest.fixedl_histogram<C>::add_squared_sample(sqVal);
+  }
+
+  static void add_all(fixedl_histogram<C>& dest, const C* vals, size_t count) {
+    dest.add_samples(vals, count);
+  }
+
+  static void add_squared_all(fixedl_histogram<C>& dest, const C* sqVals, size_t count) {
+    dest.add_squared_samples(sqVals, count);
+  }
+};
+
+// Bins the distance between two points, in the squared domain if the
+// calculator has a squared form; `value` and `add` are the two halves of `bin`
+template <
+  class DistCalc, typename C, size_t DIM, class Hist=histogram<C>,
+  bool=is_squared_dist<DistCalc, C, DIM>::value
+>
+struct pair_binner {
+  static C value(const DistCalc& calc, const npoint<C,DIM>& p0, const npoint<C,DIM>& p1) {
+    return calc(p0, p1);
+  }
+
+  static void add(Hist& dest, C val) {
+    bin_calls<C, Hist>::add(dest, val);
+  }
+
+  static void add_all(Hist& dest, const C* vals, size_t count) {
+    bin_calls<C, Hist>::add_all(dest, vals, count);
+  }
+
+  static void bin(
+    const DistCalc& calc, const npoint<C,DIM>& p0, const npoint<C,DIM>& p1,
+    Hist& dest
+  ) {
+    add(dest, value(calc, p0, p1));
+  }
+};
+
+template <class DistCalc, typename C, size_t DIM, class Hist>
+struct pair_binner<DistCalc, C, DIM, Hist, true> {
+  static C value(const DistCalc& calc, const npoint<C,DIM>& p0, const npoint<C,DIM>& p1) {
+    return calc.squared(p0, p1);
+  }
+
+  static void add(Hist& dest, C sqVal) {
+    bin_calls<C, Hist>::add_squared(dest, sqVal);
+  }
+
+  static void add_all(Hist& dest, const C* sqVals, size_t count) {
+    bin_calls<C, Hist>::add_squared_all(dest, sqVals, count);
+  }
+
+  static void bin(
+    const DistCalc& calc, const npoint<C,DIM>& p0, const npoint<C,DIM>& p1,
+    Hist& dest
+  ) {
+    add(dest, value(calc, p0, p1));
+  }
+};
+
+// Same as above, for the distances between a point and a block of coordinate columns
+template <
+  class DistCalc, typename C, size_t DIM, class Hist=histogram<C>,
+  bool=is_squared_batch_dist<DistCalc, C, DIM>::value
+>
+struct row_binner {
+  static void values(
+    const DistCalc& calc, const npoint<C,DIM>& p0,
+    const C* const* cols, size_t count, C* dest
+  ) {
+    calc(p0, cols, count, dest);
+  }
+
+  static void add_all(Hist& dest, const C* vals, size_t count) {
+    bin_calls<C, Hist>::add_all(dest, vals, count);
+  }
+};
+
+template <class DistCalc, typename C, size_t DIM, class Hist>
+struct row_binner<DistCalc, C, DIM, Hist, true> {
+  static void values(
+    const DistCalc& calc, const npoint<C,DIM>& p0,
+    const C* const* cols, size_t count, C* dest
+  ) {
+    calc.squared(p0, cols, count, dest);
+  }
+
+  static void add_all(Hist& dest, const C* sqVals, size_t count) {
+    bin_calls<C, Hist>::add_squared_all(dest, sqVals, count);
+  }
+};
+
+// Distances between the points [iBeg, iEnd) and [jBeg, jEnd), only the j>i
+// ones if `triangle`, binned into `dest`. Returns the number of pairs,
+// `binSeconds` the time spent binning them.
+// The distances of the rows of the tile are computed in one loop and binned
+// in another, a chunk of rows (see row_chunks) at a time: the two don't get
+// in the way of each other's optimization once the binning calls are inlined.
+// The generic form goes pair by pair...
+template <
+  typename C, size_t DIM, class Supplier, class DistCalc, class Hist=histogram<C>,
+  bool=is_batch_dist<DistCalc, C, DIM>::value && is_soa_supplier<Supplier, C>::value
+>
+struct tile_kernel {
+  static size_t run(
+    const Supplier& src, const DistCalc& calc,
+    size_t iBeg, size_t iEnd, size_t jBeg, size_t jEnd, bool triangle,
+    Hist& dest, std::vector<C>& buffer, double& binSeconds
+  ) {
+    using binner=pair_binner<DistCalc, C, DIM, Hist>;
+    auto chunks=make_row_chunks(buffer, [&dest](const C* vals, size_t count) {
+      binner::add_all(dest, vals, count);
+    });
+    size_t ret=0;
+    for(size_t i=iBeg; i<iEnd; i++) {
+      npoint<C,DIM> first=src(i);
+      size_t jFrom=triangle ? i+1 : jBeg;
+      size_t count=jEnd-jFrom;
+      C* row=chunks.row(count);
+      for(size_t k=0; k<count; k++) {
+        npoint<C,DIM> second=src(jFrom+k);
+        row[k]=binner::value(calc, first, second);
+      }
+      ret+=count;
+    }
+    binSeconds=chunks.flush();
+    return ret;
+  }
+};
+
+// ... while the batch one computes a whole row of the tile at once,
+// straight from the coordinate columns
+template <typename C, size_t DIM, class Supplier, class DistCalc, class Hist>
+struct tile_kernel<C, DIM, Supplier, DistCalc, Hist, true> {
+  static size_t run(
+    const Supplier& src, const DistCalc& calc,
+    size_t iBeg, size_t iEnd, size_t jBeg, size_t jEnd, bool triangle,
+    Hist& dest, std::vector<C>& buffer, double& binSeconds
+  ) {
+    using binner=row_binner<DistCalc, C, DIM, Hist>;
+    auto chunks=make_row_chunks(buffer, [&dest](const C* vals, size_t count) {
+      binner::add_all(dest, vals, count);
+    });
+    const C* cols[DIM];
+    size_t ret=0;
+    for(size_t i=iBeg; i<iEnd; i++) {
+      npoint<C,DIM> first=src(i);
+      size_t jFrom=triangle ? i+1 : jBeg;
+      size_t count=jEnd-jFrom;
+      for(size_t d=0; d<DIM; d++) {
+        cols[d]=src.coords(d)+jFrom;
+      }
+      binner::values(calc, first, cols, count, chunks.row(count));
+      ret+=count;
+    }
+    binSeconds=chunks.flush();
+    return ret;
+  }
+};
+
 template <typename T> struct is_dereferencable_base
 {
-  using type=void;
-  static constexpr bool value=false;
-};
+  using type=void;
+  static constexpr bool value=false;
+};
+
+template <typename T> struct is_dereferencable_base<T*> : public std::true_type
+{
+  using type=T;
+  static constexpr bool value=true;
+};
+
+template <typename T>
+struct is_dereferencable_base<std::shared_ptr<T>> : public std::true_type
+{
+  using type=T;
+  static constexpr bool value=true;
+};
+
+template <typename T>
+struct is_dereferencable_base<std::weak_ptr<T>> : public std::true_type
+{
+  using type=T;
+  static constexpr bool value=true;
+};
+
+template <typename T>
+struct dereferencable :
+    public is_dereferencable_base<
+      typename std::remove_reference<
+        typename std::remove_cv<T>::type
+      >
+    >
+{
+private:
+  using nocv=typename std::remove_cv<T>::type;
+  using noref=typename std::remove_reference<nocv>::type;
+public:
+  using type=typename is_dereferencable_base<noref>::type;
+  static constexpr bool value=is_dereferencable_base<noref>::value;
+
+  static type* lock(type* x) { return x; };
+
+  static std::shared_ptr<type> lock(std::shared_ptr<type>& x) { return x; }
+  static std::shared_ptr<type> lock(const std::shared_ptr<type>& x) { return x; };
+
+  static std::shared_ptr<type> lock(std::weak_ptr<type>& x) { return x.lock(); }
+  static std::shared_ptr<type> lock(const std::weak_ptr<type>& x) { return x.lock(); }
+
+};
+
+} // namespace detail
+
+// src - operator()(size_t i) to get the point at position i and size()
+//       with the result type assignable to a npoint<C,DIM>
+// DistCalc - dist_type operator()(const npoint<C,DIM>&, const npoint<C,DIM>) const
+// dest - `bool operator()(dist_type)`, called for every distance (a lambda
+//        gets inlined, a std::function doesn't); a return of `false`
+//        signals "stop computations, I'll not listen anymore"
+// seed - of the sampled pairs (see compute_distances_sampled)
+template <
+  typename C, size_t DIM,
+  class PointSupplier, class DistSink, class DistCalc
+> void compute_distances(
+  const PointSupplier& src,
+  DistSink dest, DistCalc& calc,
+  size_t max_dist_count=std::numeric_limits<size_t>::max(),
+  unsigned long long seed=0
+)
+// may throw() whatever the Supplier or dest throws.
+{
+  size_t plen=src.size();
+  if(plen>1) {
+    detail::dist_type_updater<DistCalc, PointSupplier>::update_dist(src, calc);
+    size_t maxDistCount=triangle_pairs(plen);
+    if(maxDistCount>max_dist_count) {
+      // sampled
+      std::uint64_t bits[2];
+      for(size_t count=0; count < max_dist_count; count++) {
+        if(0==(count & 1)) {
+          philox4x32::block(seed, 0, count>>1, bits);
+        }
+        std::uint64_t i, j;
+        unordered_pair(uniform_below(bits[count & 1], maxDistCount), i, j);
+        npoint<C,DIM> first=src(i), second=src(j);
+        if( !dest(calc(first,second)) ) {
+          break;
+        }
+      }
+    }
+    else { // exhaustive
+      for(size_t i=0; i<plen; i++) {
+        npoint<C,DIM> first=src(i);
+        for(size_t j=i+1; j<plen; j++) {
+          npoint<C,DIM> second=src(j);
+          if( !dest(calc(first,second)) ) {
+            return;
+          }
+        }
+      }
+    }
+  }
+}
+
+// A part of the i<j pair triangle of a point supplier: the pairs within
+// [first_begin, first_end) if `intra()`, otherwise the pairs between
+// [first_begin, first_end) and [second_begin, second_end) (two ranges
+// expected not to overlap)
+struct pair_block {
+  size_t first_begin, first_end;
+  size_t second_begin, second_end;
+
+  pair_block(size_t begin, size_t end) :
+    first_begin(begin), first_end(end), second_begin(begin), second_end(end)
+  {
+  }
+
+  pair_block(size_t begin0, size_t end0, size_t begin1, size_t end1) :
+    first_begin(begin0), first_end(end0), second_begin(begin1), second_end(end1)
+  {
+  }
+
+  bool intra() const {
+    return this->first_begin==this->second_begin && this->first_end==this->second_end;
+  }
+
+  size_t pair_count() const {
+    size_t len0=this->first_end-this->first_begin;
+    return
+        this->intra()
+      ? triangle_pairs(len0)
+      : len0*(this->second_end-this->second_begin)
+    ;
+  }
+};
+
+// The seconds the worker handing a tile over to a TileSink spent binning
+// its samples, for the sinks keeping stats: set by the engines right
+// before each call, on the calling thread. Along with the thread that
+// computed the tile, if not the calling one (see compute_distances_sampled).
+class tile_timing {
+public:
+  static double bin_seconds() {
+    return slot();
+  }
+
+  static void set_bin_seconds(double seconds) {
+    slot()=seconds;
+  }
+
+  static std::thread::id worker() {
+    std::thread::id ret=worker_slot();
+    return std::thread::id()==ret ? std::this_thread::get_id() : ret;
+  }
+
+  // a default-constructed id: the calling thread
+  static void set_worker(std::thread::id computedBy) {
+    worker_slot()=computedBy;
+  }
+
+private:
+  static double& slot() {
+    static thread_local double ret=0;
+    return ret;
+  }
+
+  static std::thread::id& worker_slot() {
+    static thread_local std::thread::id ret;
+    return ret;
+  }
+};
+
+namespace detail {
+
+// The per-worker state of the engines below, `Hist` being the static
+// type of the partial histograms (the dynamic one is that of the `proto`)
+template <typename C, class Hist=histogram<C>>
+struct worker_scratch {
+  std::shared_ptr<Hist> partial;
+  std::vector<C> buffer;
+};
+
+template <typename C, class Hist=histogram<C>>
+std::vector<worker_scratch<C, Hist>> make_scratch(unsigned workers, const histogram<C>& proto) {
+  std::vector<worker_scratch<C, Hist>> ret(workers);
+  for(auto& s : ret) {
+    s.partial=std::static_pointer_cast<Hist>(proto.empty_clone());
+  }
+  return ret;
+}
+
+// The histograms whose concrete class the engines know (and bin into
+// without virtual calls): fixedl_histogram, but not its derived classes
+template <typename C>
+bool is_fixedl(const histogram<C>& h) {
+  return typeid(h)==typeid(fixedl_histogram<C>);
+}
+
+// distance calculators may lazily init their state on first use:
+// make it happen before the fan-out
+template <typename C, size_t DIM, class PointSupplier, class DistCalc>
+void prepare_dist(const PointSupplier& src, DistCalc& calc) {
+  detail::dist_type_updater<DistCalc, PointSupplier>::update_dist(src, calc);
+  if(src.size()>1) {
+    calc(src(0), src(1));
+  }
+}
+
+} // namespace detail
+
+namespace detail {
+
+// compute_distances_tiled, binning into partials of the static type `Hist`
+template <
+  class Hist, typename C, size_t DIM,
+  class PointSupplier, class DistCalc, class TileSink
+> void tiled_run(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+  unsigned threads, size_t tile_len
+)
+{
+  detail::prepare_dist<C, DIM>(src, calc);
+  if(0==tile_len) {
+    tile_len=512;
+  }
+
+  work_stealing_pool pool(threads);
+  std::vector<worker_scratch<C, Hist>> scratch=make_scratch<C, Hist>(pool.workers(), proto);
+  std::atomic<bool> stop(false);
+  std::mutex sinkLock;
+
+  auto tile=[&](size_t blockIx, size_t iBeg, size_t iEnd, size_t jBeg, size_t jEnd, unsigned worker) {
+    if(stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    Hist& partial=*scratch[worker].partial;
+    double binned=0;
+    size_t pairs=tile_kernel<C, DIM, PointSupplier, DistCalc, Hist>::run(
+      src, calc, iBeg, iEnd, jBeg, jEnd, iBeg==jBeg, partial, scratch[worker].buffer, binned
+    );
+    {
+      std::unique_lock<std::mutex> barrier(sinkLock);
+      tile_timing::set_bin_seconds(binned);
+      if(!stop.load() && !tile_done(blockIx, static_cast<const histogram<C>&>(partial), pairs, true)) {
+        stop.store(true);
+      }
+    }
+    partial.clear();
+  };
+
+  std::vector<work_stealing_pool::task_type> tiles;
+  for(size_t k=0; k<blocks.size(); k++) {
+    const pair_block& block=blocks[k];
+    bool intra=block.intra();
+    for(size_t iBeg=block.first_begin; iBeg<block.first_end; iBeg+=tile_len) {
+      size_t iEnd=std::min(block.first_end, iBeg+tile_len);
+      for(
+        size_t jBeg=(intra ? iBeg : block.second_begin);
+        jBeg<block.second_end;
+        jBeg+=tile_len
+      ) {
+        size_t jEnd=std::min(block.second_end, jBeg+tile_len);
+        using namespace std::placeholders;
+        tiles.push_back(std::bind(tile, k, iBeg, iEnd, jBeg, jEnd, _1));
+      }
+    }
+  }
+  pool.run(tiles);
+}
+} // namespace detail
+
+// Exhaustive computation of the pairs of `blocks`, spread over a work_stealing_pool.
+// Each block is split into square tiles of `tile_len` points per side (the
+// two ranges of points of a tile should stay in L1 cache).
+// Each worker bins the distances into a private histogram, an `empty_clone()`
+// of `proto`, handed to
+//   `bool tile_done(size_t blockIx, const histogram<C>& partial, size_t pairs, bool balanced)`
+// at the end of every tile (always `balanced`, see compute_distances_sampled)
+// and cleared afterwards. The `tile_done` calls are serialized, a return
+// of `false` stops the workers at their next tile. During a call,
+// tile_timing::bin_seconds() is the time spent binning the tile (the
+// other engines below do the same).
+// src - operator()(size_t i) and size(), safe to call from multiple threads
+// DistCalc - as for compute_distances, with an operator() safe to call
+//            from multiple threads
+// When the `src` provides coordinate columns (`const C* coords(size_t d) const`)
+// and `calc` has a batch form (see l2), the tiles are computed row by row
+// through the batch form. With a fixedl_histogram `proto`, the kernels are
+// instantiated for it and bin with no virtual calls (see detail::bin_calls).
+template <
+  typename C, size_t DIM,
+  class PointSupplier, class DistCalc, class TileSink
+> void compute_distances_tiled(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t tile_len=512
+)
+// may throw() whatever the Supplier, the DistCalc or tile_done throws.
+{
+  if(detail::is_fixedl(proto)) {
+    detail::tiled_run<fixedl_histogram<C>, C, DIM>(
+      src, blocks, calc, proto, tile_done, threads, tile_len
+    );
+  }
+  else {
+    detail::tiled_run<histogram<C>, C, DIM>(
+      src, blocks, calc, proto, tile_done, threads, tile_len
+    );
+  }
+}
+
+namespace detail {
+
+// compute_distances_sampled, binning into partials of the static type `Hist`
+template <
+  class Hist, typename C, size_t DIM,
+  class PointSupplier, class DistCalc, class TileSink
+> void sampled_run(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  const std::vector<size_t>& quotas,
+  DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+  unsigned threads, size_t chunk_len, unsigned long long seed
+)
+{
+  detail::prepare_dist<C, DIM>(src, calc);
+  if(0==chunk_len) {
+    chunk_len=65536;
+  }
+
+  work_stealing_pool pool(threads);
+  // sets of private histograms (one per block) for the rounds, recycled
+  // once handed over
+  std::vector<std::vector<std::shared_ptr<Hist>>> spare;
+  auto take_set=[&]() -> std::vector<std::shared_ptr<Hist>> {
+    std::vector<std::shared_ptr<Hist>> ret;
+    if(!spare.empty()) {
+      ret.swap(spare.back());
+      spare.pop_back();
+    }
+    else {
+      for(size_t k=0; k<blocks.size(); k++) {
+        ret.push_back(std::static_pointer_cast<Hist>(proto.empty_clone()));
+      }
+    }
+    return ret;
+  };
+  std::atomic<bool> stop(false);
+  std::mutex sinkLock;
+
+  // the samples go through a row_chunks in rows of `row_len`; returns
+  // the seconds spent binning them
+  const size_t row_len=256;
+  auto sample=[&](
+    size_t blockIx, size_t from, size_t count, Hist& partial, std::vector<C>& buffer
+  ) -> double {
+    using binner=pair_binner<DistCalc, C, DIM, Hist>;
+    const pair_block& block=blocks[blockIx];
+    bool intra=block.intra();
+    std::uint64_t pairs=block.pair_count();
+    std::uint64_t secondLen=block.second_end-block.second_begin;
+    std::uint64_t bits[2];
+    auto chunks=make_row_chunks(buffer, [&partial](const C* vals, size_t len) {
+      binner::add_all(partial, vals, len);
+    });
+    C* row=nullptr;
+    for(size_t s=from; s<from+count; s++) {
+      if(0==(s-from)%row_len) {
+        row=chunks.row(std::min(row_len, from+count-s));
+      }
+      if(s==from || 0==(s & 1)) {
+        philox4x32::block(seed, blockIx, s>>1, bits);
+      }
+      // straight to a pair, no i==j rejections
+      std::uint64_t p=uniform_below(bits[s & 1], pairs), i, j;
+      if(intra) {
+        unordered_pair(p, i, j);
+        i+=block.first_begin;
+        j+=block.first_begin;
+      }
+      else {
+        i=block.first_begin+p/secondLen;
+        j=block.second_begin+p%secondLen;
+      }
+      row[(s-from)%row_len]=binner::value(calc, src(i), src(j));
+    }
+    return chunks.flush();
+  };
+
+  size_t total=0;
+  for(size_t k=0; k<blocks.size(); k++) {
+    if(blocks[k].pair_count()) {
+      total+=quotas[k];
+    }
+  }
+  size_t rounds=(total+chunk_len-1)/chunk_len;
+  // the samples of each block in the round `r`
+  auto round_range=[&](size_t k, size_t r, size_t& from, size_t& to) {
+    long double quota=blocks[k].pair_count() ? quotas[k] : 0;
+    from=static_cast<size_t>(quota*r/rounds);
+    to=static_cast<size_t>(quota*(r+1)/rounds);
+  };
+  // Handed over in the round order, whichever worker completes them: a
+  // stop (e.g. on convergence) falls on the same round boundary whatever
+  // the threads and their timing.
+  std::vector<std::vector<std::shared_ptr<Hist>>> completed(rounds);
+  std::vector<double> binned(rounds, 0);
+  std::vector<std::thread::id> computedBy(rounds);
+  size_t handed=0;
+  std::atomic<size_t> next(0);
+  auto round=[&](unsigned) {
+    // taken in order, so that they complete about in order
+    size_t r=next.fetch_add(1);
+    if(stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    std::vector<std::shared_ptr<Hist>> partials;
+    {
+      std::unique_lock<std::mutex> barrier(sinkLock);
+      partials=take_set();
+    }
+    std::vector<C> buffer;
+    double seconds=0;
+    for(size_t k=0; k<blocks.size(); k++) {
+      size_t from, to;
+      round_range(k, r, from, to);
+      if(to>from) {
+        seconds+=sample(k, from, to-from, *partials[k], buffer);
+      }
+    }
+    std::unique_lock<std::mutex> barrier(sinkLock);
+    completed[r].swap(partials);
+    binned[r]=seconds;
+    computedBy[r]=std::this_thread::get_id();
+    while(handed<rounds && !completed[handed].empty()) {
+      std::vector<std::shared_ptr<Hist>>& ready=completed[handed];
+      size_t last=blocks.size();
+      for(size_t k=0; k<blocks.size(); k++) {
+        size_t from, to;
+        round_range(k, handed, from, to);
+        if(to>from) {
+          last=k;
+        }
+      }
+      for(size_t k=0; k<=last && k<blocks.size(); k++) {
+        size_t from, to;
+        round_range(k, handed, from, to);
+        if(to>from && !stop.load()) {
+          const histogram<C>& partial=*ready[k];
+          // the round's binning, with its first block
+          tile_timing::set_bin_seconds(binned[handed]);
+          tile_timing::set_worker(computedBy[handed]);
+          binned[handed]=0;
+          if(!tile_done(k, partial, to-from, k==last)) {
+            stop.store(true);
+          }
+        }
+      }
+      tile_timing::set_worker(std::thread::id());
+      for(auto& partial : ready) {
+        partial->clear();
+      }
+      spare.emplace_back();
+      spare.back().swap(ready);
+      handed++;
+    }
+  };
+  std::vector<work_stealing_pool::task_type> tasks(rounds, round);
+  pool.run(tasks);
+}
+} // namespace detail
+
+// Sampled computation: `quotas[k]` pairs drawn at random (with replacement)
+// among the pairs of `blocks[k]`, spread over a work_stealing_pool in rounds
+// of about `chunk_len` samples. Each round takes the same fraction of every
+// block's quota and hands the per-block private histograms to `tile_done`
+// (as for compute_distances_tiled, `pairs` being the count of samples) in one
+// go, the rounds in their order (a round completed early waits for those
+// before it); `balanced` is set on the last call of a round: whatever was
+// handed over up to there makes a proportionally stratified sample, safe to
+// stop at. A stop thus falls on the same round whatever the thread count.
+// The s-th sample of the k-th block comes from the Philox stream k of the `seed`,
+// at s: the same seed gives the same samples whatever the thread or chunk count.
+template <
+  typename C, size_t DIM,
+  class PointSupplier, class DistCalc, class TileSink
+> void compute_distances_sampled(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  const std::vector<size_t>& quotas,
+  DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t chunk_len=65536, unsigned long long seed=0
+)
+// may throw() whatever the Supplier, the DistCalc or tile_done throws.
+{
+  if(detail::is_fixedl(proto)) {
+    detail::sampled_run<fixedl_histogram<C>, C, DIM>(
+      src, blocks, quotas, calc, proto, tile_done, threads, chunk_len, seed
+    );
+  }
+  else {
+    detail::sampled_run<histogram<C>, C, DIM>(
+      src, blocks, quotas, calc, proto, tile_done, threads, chunk_len, seed
+    );
+  }
+}
+
+// Exhaustive L2 computation of the pairs of `blocks` by dual-tree counting
+// (see dual_tree_counter): a k-d tree for each distinct range of points of
+// the blocks, the node pairs of each block split down to about `task_pairs`
+// pairs of points, the resulting tasks spread over a work_stealing_pool.
+// Each worker counts into a private copy of `proto`, handed to `tile_done` as
+// for compute_distances_tiled (a call per task). Same counts as the tiled
+// computation with l2, without computing the distances of the node pairs that
+// are entirely within a slot. A `leaf_len` of 0 picks the leaves of each tree
+// from the slot width (see dual_tree_leaf_len). The tree builds and the
+// splitting into tasks end early once `cancel_flag` (if any) is raised,
+// computing nothing more.
+template <
+  typename C, size_t DIM, class PointSupplier, class TileSink
+> void compute_distances_dualtree(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  const fixedl_histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t task_pairs=262144, size_t leaf_len=0,
+  const std::atomic<bool>* cancel_flag=nullptr
+)
+// may throw() whatever the Supplier or tile_done throws.
+{
+  using tree_type=kd_tree<C, DIM>;
+  using range=std::pair<size_t, size_t>;
+  if(0==task_pairs) {
+    task_pairs=262144;
+  }
+  auto cancelled=[cancel_flag]() {
+    return cancel_flag && cancel_flag->load(std::memory_order_relaxed);
+  };
+
+  work_stealing_pool pool(threads);
+  std::map<range, std::shared_ptr<tree_type>> trees;
+  for(const pair_block& block : blocks) {
+    trees[range(block.first_begin, block.first_end)];
+    trees[range(block.second_begin, block.second_end)];
+  }
+  std::vector<work_stealing_pool::task_type> builds;
+  for(auto& t : trees) {
+    range r=t.first;
+    std::shared_ptr<tree_type>* dest=&t.second;
+    builds.push_back([&src, &proto, r, dest, leaf_len, &cancelled](unsigned) {
+      if(!cancelled()) {
+        size_t leaf=
+            0==leaf_len
+          ? dual_tree_leaf_len<C, DIM>(src, r.first, r.second, proto)
+          : leaf_len
+        ;
+        *dest=std::make_shared<tree_type>(src, r.first, r.second, leaf);
+      }
+    });
+  }
+  pool.run(builds);
+  if(cancelled()) {
+    return;
+  }
+
+  // node pairs (within a node if `self`) small enough to make a task
+  struct node_pair {
+    size_t block;
+    const tree_type* ta;
+    size_t a;
+    const tree_type* tb;
+    size_t b;
+    bool self;
+  };
+  std::vector<node_pair> pending, units;
+  for(size_t k=0; k<blocks.size(); k++) {
+    const pair_block& block=blocks[k];
+    const tree_type* ta=trees[range(block.first_begin, block.first_end)].get();
+    const tree_type* tb=trees[range(block.second_begin, block.second_end)].get();
+    if(!ta->empty() && !tb->empty()) {
+      node_pair root={k, ta, 0, tb, 0, block.intra()};
+      pending.push_back(root);
+    }
+  }
+  while(!pending.empty()) {
+    if(cancelled()) {
+      return;
+    }
+    node_pair np=pending.back();
+    pending.pop_back();
+    const typename tree_type::node& na=np.ta->at(np.a);
+    const typename tree_type::node& nb=np.tb->at(np.b);
+    size_t pairs=np.self ? triangle_pairs(na.size()) : na.size()*nb.size();
+    bool aSplits=!na.leaf(), bSplits=!np.self && !nb.leaf();
+    if(pairs<=task_pairs || !(aSplits || bSplits)) {
+      units.push_back(np);
+    }
+    else if(np.self) {
+      node_pair l={np.block, np.ta, na.left, np.ta, na.left, true};
+      node_pair r={np.block, np.ta, na.right, np.ta, na.right, true};
+      node_pair lr={np.block, np.ta, na.left, np.ta, na.right, false};
+      pending.push_back(l);
+      pending.push_back(r);
+      pending.push_back(lr);
+    }
+    else if(aSplits && (!bSplits || na.size()>=nb.size())) {
+      node_pair l={np.block, np.ta, na.left, np.tb, np.b, false};
+      node_pair r={np.block, np.ta, na.right, np.tb, np.b, false};
+      pending.push_back(l);
+      pending.push_back(r);
+    }
+    else {
+      node_pair l={np.block, np.ta, np.a, np.tb, nb.left, false};
+      node_pair r={np.block, np.ta, np.a, np.tb, nb.right, false};
+      pending.push_back(l);
+      pending.push_back(r);
+    }
+  }
+
+  std::vector<std::shared_ptr<fixedl_histogram<C>>> partials;
+  std::vector<dual_tree_counter<C, DIM>> counters;
+  counters.reserve(pool.workers());
+  for(unsigned w=0; w<pool.workers(); w++) {
+    partials.push_back(std::make_shared<fixedl_histogram<C>>(proto));
+    partials.back()->clear();
+    counters.emplace_back(*partials.back());
+  }
+  std::atomic<bool> stop(false);
+  std::mutex sinkLock;
+
+  auto unit=[&](size_t ix, unsigned worker) {
+    if(stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    const node_pair& np=units[ix];
+    dual_tree_counter<C, DIM>& counter=counters[worker];
+    size_t pairs=
+        np.self
+      ? counter.count(*np.ta, np.ta->at(np.a))
+      : counter.count(*np.ta, np.ta->at(np.a), *np.tb, np.tb->at(np.b))
+    ;
+    histogram<C>& partial=*partials[worker];
+    {
+      std::unique_lock<std::mutex> barrier(sinkLock);
+      tile_timing::set_bin_seconds(counter.bin_seconds());
+      if(!stop.load() && !tile_done(np.block, static_cast<const histogram<C>&>(partial), pairs, true)) {
+        stop.store(true);
+      }
+    }
+    partial.clear();
+  };
+
+  std::vector<work_stealing_pool::task_type> tasks;
+  for(size_t i=0; i<units.size(); i++) {
+    using namespace std::placeholders;
+    tasks.push_back(std::bind(unit, i, _1));
+  }
+  pool.run(tasks);
+}
+
+// Exhaustive L2 computation of the pairs of `blocks` into a histogram truncated
+// well below the diameter of the points: a cell_list, of cells `reach` times
+// finer than the histogram's max_sample_value() (0 - see cell_grid_reach), for
+// each distinct range of points of the blocks; only the pairs in neighbouring
+// cells (see cell_grid) get computed, all the others being known to be above
+// the histogram's range and counted as its overflow.
+// The neighbouring cells of a block are split in tasks of about `task_pairs`
+// pairs, spread over a work_stealing_pool. Each worker counts into a private
+// copy of `proto`, handed to `tile_done` as for compute_distances_tiled.
+// Same counts (overflow included) as the tiled computation with l2.
+// The list builds and the splitting into tasks end early once `cancel_flag`
+// (if any) is raised, as for compute_distances_dualtree.
+template <
+  typename C, size_t DIM, class PointSupplier, class TileSink
+> void compute_distances_celllist(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  const fixedl_histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t task_pairs=262144, size_t reach=0,
+  const std::atomic<bool>* cancel_flag=nullptr
+)
+// may throw() whatever the Supplier or tile_done throws.
+{
+  using list_type=cell_list<C, DIM>;
+  using range=std::pair<size_t, size_t>;
+  if(0==task_pairs) {
+    task_pairs=262144;
+  }
+  auto cancelled=[cancel_flag]() {
+    return cancel_flag && cancel_flag->load(std::memory_order_relaxed);
+  };
+
+  work_stealing_pool pool(threads);
+  std::map<range, std::shared_ptr<list_type>> lists;
+  for(const pair_block& block : blocks) {
+    lists[range(block.first_begin, block.first_end)];
+    lists[range(block.second_begin, block.second_end)];
+  }
+  npoint<C, DIM> lo=npoint<C, DIM>::Zero(), hi=lo;
+  bool empty=true;
+  size_t pointCount=0;
+  for(auto& l : lists) {
+    for(size_t i=l.first.first; i<l.first.second; i++) {
+      npoint<C, DIM> p=src(i);
+      lo=empty ? p : lo.cwiseMin(p);
+      hi=empty ? p : hi.cwiseMax(p);
+      empty=false;
+    }
+    pointCount+=l.first.second-l.first.first;
+  }
+  // the float distances (see dual_tree_counter) up to max are
+  // at most a rounding away from the true ones
+  const long double margin=4*(DIM+1)*static_cast<long double>(std::numeric_limits<C>::epsilon());
+  const long double reachLen=proto.max_sample_value()*(1+margin);
+  if(0==reach) {
+    reach=cell_grid_reach<C, DIM>(pointCount, lo, hi, reachLen);
+  }
+  cell_grid<C, DIM> grid(lo, hi, reachLen, reach);
+  std::vector<work_stealing_pool::task_type> builds;
+  for(auto& l : lists) {
+    range r=l.first;
+    std::shared_ptr<list_type>* dest=&l.second;
+    builds.push_back([&src, &grid, r, dest, &cancelled](unsigned) {
+      if(!cancelled()) {
+        *dest=std::make_shared<list_type>(src, r.first, r.second, grid);
+      }
+    });
+  }
+  pool.run(builds);
+  if(cancelled()) {
+    return;
+  }
+
+  // cells [cellBeg, cellEnd) of the first list of the block against their neighbours
+  struct cell_run {
+    size_t block;
+    const list_type* first;
+    const list_type* second;
+    size_t cellBeg, cellEnd;
+    size_t pairs;
+  };
+  std::vector<cell_run> runs;
+  std::vector<std::pair<size_t, size_t>> keys;
+  std::shared_ptr<fixedl_histogram<C>> overflow=std::make_shared<fixedl_histogram<C>>(proto);
+  overflow->clear();
+  for(size_t k=0; k<blocks.size(); k++) {
+    if(cancelled()) {
+      return;
+    }
+    const pair_block& block=blocks[k];
+    bool intra=block.intra();
+    const list_type* first=lists[range(block.first_begin, block.first_end)].get();
+    const list_type* second=lists[range(block.second_begin, block.second_end)].get();
+    size_t visited=0;
+    cell_run run={k, first, second, 0, 0, 0};
+    for(size_t c=0; c<first->cell_count(); c++) {
+      size_t len=first->end(c)-first->begin(c);
+      size_t pairs=intra ? triangle_pairs(len) : 0;
+      grid.neighbours(first->key(c), intra, keys);
+      for(const std::pair<size_t, size_t>& cells : keys) {
+        std::pair<size_t, size_t> around=second->points_of(cells.first, cells.second);
+        pairs+=len*(around.second-around.first);
+      }
+      run.cellEnd=c+1;
+      run.pairs+=pairs;
+      visited+=pairs;
+      if(run.pairs>=task_pairs) {
+        if(cancelled()) {
+          return;
+        }
+        runs.push_back(run);
+        run.cellBeg=run.cellEnd;
+        run.pairs=0;
+      }
+    }
+    if(run.cellEnd>run.cellBeg) {
+      runs.push_back(run);
+    }
+    size_t above=block.pair_count()-visited;
+    if(above) {
+      overflow->add_overflow(above);
+      if(!tile_done(k, static_cast<const histogram<C>&>(*overflow), above, true)) {
+        return;
+      }
+      overflow->clear();
+    }
+  }
+
+  std::vector<detail::worker_scratch<C, fixedl_histogram<C>>> scratch=
+    detail::make_scratch<C, fixedl_histogram<C>>(pool.workers(), proto)
+  ;
+  std::atomic<bool> stop(false);
+  std::mutex sinkLock;
+
+  auto unit=[&](size_t ix, unsigned worker) {
+    if(stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    const cell_run& run=runs[ix];
+    bool intra=blocks[run.block].intra();
+    fixedl_histogram<C>& partial=*scratch[worker].partial;
+    std::vector<C>& buffer=scratch[worker].buffer;
+    std::vector<std::pair<size_t, size_t>> around;
+    const soa_points<C, DIM>& pa=run.first->points();
+    const soa_points<C, DIM>& pb=run.second->points();
+    const C* cols[DIM];
+    auto chunks=make_row_chunks(buffer, [&partial](const C* sqVals, size_t count) {
+      partial.add_squared_samples(sqVals, count);
+    });
+    auto bin=[&](size_t i, size_t jBeg, size_t jEnd) {
+      if(jEnd<=jBeg) {
+        return;
+      }
+      npoint<C, DIM> p=pa(i);
+      for(size_t d=0; d<DIM; d++) {
+        cols[d]=pb.coords(d)+jBeg;
+      }
+      simd::l2_batch<C, DIM, false>(p.data(), cols, jEnd-jBeg, chunks.row(jEnd-jBeg));
+    };
+    for(size_t c=run.cellBeg; c<run.cellEnd; c++) {
+      size_t b=run.first->begin(c), e=run.first->end(c);
+      if(intra) {
+        for(size_t i=b; i<e; i++) {
+          bin(i, i+1, e);
+        }
+      }
+      grid.neighbours(run.first->key(c), intra, around);
+      for(const std::pair<size_t, size_t>& cells : around) {
+        std::pair<size_t, size_t> others=run.second->points_of(cells.first, cells.second);
+        for(size_t i=b; i<e; i++) {
+          bin(i, others.first, others.second);
+        }
+      }
+    }
+    double binned=chunks.flush();
+    {
+      std::unique_lock<std::mutex> barrier(sinkLock);
+      tile_timing::set_bin_seconds(binned);
+      if(!stop.load() && !tile_done(run.block, static_cast<const histogram<C>&>(partial), run.pairs, true)) {
+        stop.store(true);
+      }
+    }
+    partial.clear();
+  };
+
+  std::vector<work_stealing_pool::task_type> tasks;
+  for(size_t i=0; i<runs.size(); i++) {
+    using namespace std::placeholders;
+    tasks.push_back(std::bind(unit, i, _1));
+  }
+  pool.run(tasks);
+}
+
+// Approximate planar L2 computation of the pairs of `blocks` by grid
+// correlation (see grid_correlator, for the error bound): a grid of
+// `grid_len` cells per side over the bounding box of the points in the
+// blocks, a spectrum for each distinct range of points of the blocks and
+// a correlation per block. Each block is handed to `tile_done` (as for
+// compute_distances_tiled) in one go, as a private copy of `proto`.
+template <
+  typename C, class PointSupplier, class TileSink
+> void compute_distances_fft(
+  const PointSupplier& src, const std::vector<pair_block>& blocks,
+  const fixedl_histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t grid_len=1024
+)
+// may throw() whatever the Supplier or tile_done throws.
+{
+  using range=std::pair<size_t, size_t>;
+  using correlator_type=grid_correlator<C>;
+
+  std::map<range, std::shared_ptr<typename correlator_type::spectrum_type>> spectra;
+  for(const pair_block& block : blocks) {
+    spectra[range(block.first_begin, block.first_end)];
+    spectra[range(block.second_begin, block.second_end)];
+  }
+  npoint<C, 2> lo=npoint<C, 2>::Zero(), hi=lo;
+  bool empty=true;
+  for(auto& s : spectra) {
+    for(size_t i=s.first.first; i<s.first.second; i++) {
+      npoint<C, 2> p=src(i);
+      lo=empty ? p : lo.cwiseMin(p);
+      hi=empty ? p : hi.cwiseMax(p);
+      empty=false;
+    }
+  }
+  std::shared_ptr<fixedl_histogram<C>> partial=std::make_shared<fixedl_histogram<C>>(proto);
+  partial->clear();
+  if(empty) {
+    tile_timing::set_bin_seconds(0);
+    for(size_t k=0; k<blocks.size(); k++) {
+      if(!tile_done(k, static_cast<const histogram<C>&>(*partial), 0, true)) {
+        return;
+      }
+    }
+    return;
+  }
+  correlator_type correlator(lo, hi, grid_len, threads);
+  for(auto& s : spectra) {
+    s.second=correlator.spectrum(src, s.first.first, s.first.second);
+  }
+
+  std::vector<double> corr;
+  for(size_t k=0; k<blocks.size(); k++) {
+    const pair_block& block=blocks[k];
+    partial->clear();
+    correlator.correlate(
+      *spectra[range(block.first_begin, block.first_end)],
+      *spectra[range(block.second_begin, block.second_end)],
+      corr
+    );
+    auto binning=std::chrono::steady_clock::now();
+    correlator.bin(corr, block.intra(), block.first_end-block.first_begin, *partial);
+    tile_timing::set_bin_seconds(
+      std::chrono::duration<double>(std::chrono::steady_clock::now()-binning).count()
+    );
+    if(!tile_done(k, static_cast<const histogram<C>&>(*partial), block.pair_count(), true)) {
+      return;
+    }
+  }
+}
+
+// Exhaustive L2 computation of the pairs of `blocks` of dense_points (any
+// dimension), split into square tiles of `tile_len` points per side and
+// spread over a work_stealing_pool as in compute_distances_tiled; each tile
+// goes through a gram_l2 matrix product. The `tile_done` contract is that of
+// compute_distances_tiled. Same counts as binning the direct squared
+// distances pair by pair.
+template <typename C, class TileSink>
+void compute_distances_dense(
+  const dense_points<C>& src, const std::vector<pair_block>& blocks,
+  const fixedl_histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t tile_len=256
+)
+// may throw() whatever tile_done throws.
+{
+  using matrix_type=typename gram_l2<C>::matrix_type;
+  if(0==tile_len) {
+    tile_len=256;
+  }
 
-template <typename T> struct is_dereferencable_base<T*> : public std::true_type
+  const gram_l2<C> kernel(src);
+  work_stealing_pool pool(threads);
+  std::vector<detail::worker_scratch<C, fixedl_histogram<C>>> scratch=
+    detail::make_scratch<C, fixedl_histogram<C>>(pool.workers(), proto)
+  ;
+  std::vector<matrix_type> grams(pool.workers());
+  std::atomic<bool> stop(false);
+  std::mutex sinkLock;
+
+  auto tile=[&](size_t blockIx, size_t iBeg, size_t iEnd, size_t jBeg, size_t jEnd, unsigned worker) {
+    if(stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    fixedl_histogram<C>& partial=*scratch[worker].partial;
+    double binned=0;
+    size_t pairs=kernel.run(iBeg, iEnd, jBeg, jEnd, iBeg==jBeg, partial, grams[worker], binned);
+    {
+      std::unique_lock<std::mutex> barrier(sinkLock);
+      tile_timing::set_bin_seconds(binned);
+      if(!stop.load() && !tile_done(blockIx, static_cast<const histogram<C>&>(partial), pairs, true)) {
+        stop.store(true);
+      }
+    }
+    partial.clear();
+  };
+
+  std::vector<work_stealing_pool::task_type> tiles;
+  for(size_t k=0; k<blocks.size(); k++) {
+    const pair_block& block=blocks[k];
+    bool intra=block.intra();
+    for(size_t iBeg=block.first_begin; iBeg<block.first_end; iBeg+=tile_len) {
+      size_t iEnd=std::min(block.first_end, iBeg+tile_len);
+      for(
+        size_t jBeg=(intra ? iBeg : block.second_begin);
+        jBeg<block.second_end;
+        jBeg+=tile_len
+      ) {
+        size_t jEnd=std::min(block.second_end, jBeg+tile_len);
+        using namespace std::placeholders;
+        tiles.push_back(std::bind(tile, k, iBeg, iEnd, jBeg, jEnd, _1));
+      }
+    }
+  }
+  pool.run(tiles);
+}
+
+// The L2 spectrum of all the pairs of `points`, in `slots` slots over
+// [0, maxDist] (0 - up to the diagonal of their bounding box); the headless
+// counterpart of histogram_filler for points of any dimension.
+template <typename C>
+std::shared_ptr<fixedl_histogram<C>> dense_spectrum(
+  const dense_points<C>& points, size_t slots, C maxDist=0, unsigned threads=0
+) {
+  if(!(maxDist>0)) {
+    maxDist=points.diag_len();
+  }
+  std::shared_ptr<fixedl_histogram<C>> ret=std::make_shared<fixedl_histogram<C>>(slots, 0, maxDist);
+  std::vector<pair_block> blocks(1, pair_block(0, points.size()));
+  compute_distances_dense(
+    points, blocks, *ret,
+    [&ret](size_t, const histogram<C>& partial, size_t, bool) {
+      ret->merge(partial);
+      return true;
+    },
+    threads
+  );
+  return ret;
+}
+
+// Exhaustive computation of all the pairs of a point set too large to be held in
+// memory: the points are taken in blocks of `block_len`, the pair triangle
+// gone through as block pairs (i, j>=i), row by row. Block i is read once
+// per row and kept; the block pairs are computed (as by compute_distances_tiled,
+// `tile_len` and `threads` included) from one of two buffers, while the next
+// block pair gets read into the other one: the reads overlap the computation.
+// About 5 blocks are in memory at any time.
+// BlockSource - `size()` and `read(size_t begin, size_t end, soa_points<C,DIM>& dest)`,
+//               appending the points [begin, end) to `dest` (see point_file_reader);
+//               the reads happen on another thread, one at a time
+// DistCalc - as for compute_distances_tiled, not updated from the points (the
+//            points are only seen a block pair at a time)
+// tile_done - as for compute_distances_tiled, `blockIx` being always 0
+template <
+  typename C, size_t DIM,
+  class BlockSource, class DistCalc, class TileSink
+> void compute_distances_streamed(
+  BlockSource& src, DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+  unsigned threads=0, size_t block_len=size_t(1)<<20, size_t tile_len=512
+)
+// may throw() whatever the BlockSource, the DistCalc or tile_done throws.
 {
-  using type=T;
-  static constexpr bool value=true;
+  static_assert(
+    !detail::is_observer_dist<DistCalc, soa_points<C, DIM>>::value,
+    "the distance can't depend on the points, seen only a block pair at a time"
+  );
+  if(0==block_len) {
+    block_len=size_t(1)<<20;
+  }
+  size_t len=src.size();
+  size_t blockCount=(len+block_len-1)/block_len;
+  std::vector<std::pair<size_t, size_t>> schedule;
+  for(size_t i=0; i<blockCount; i++) {
+    for(size_t j=i; j<blockCount; j++) {
+      schedule.push_back(std::make_pair(i, j));
+    }
+  }
+  if(schedule.empty()) {
+    return;
+  }
+
+  soa_points<C, DIM> resident; // the first block of the row, only touched by the reads
+  soa_points<C, DIM> buffers[2];
+  // a buffer holds the first block followed by the second one, if another
+  auto load=[&](size_t step, soa_points<C, DIM>* dest) {
+    size_t i=schedule[step].first, j=schedule[step].second;
+    dest->clear();
+    if(i==j) {
+      resident.clear();
+      src.read(i*block_len, std::min(len, (i+1)*block_len), resident);
+      dest->append(resident, 0, resident.size());
+    }
+    else {
+      dest->append(resident, 0, resident.size());
+      src.read(j*block_len, std::min(len, (j+1)*block_len), *dest);
+    }
+  };
+
+  bool stopped=false;
+  auto sink=[&](size_t, const histogram<C>& partial, size_t pairs, bool balanced) {
+    bool ret=tile_done(0, partial, pairs, balanced);
+    stopped=stopped || !ret;
+    return ret;
+  };
+  std::future<void> pending=std::async(std::launch::async, load, 0, &buffers[0]);
+  for(size_t step=0; step<schedule.size() && !stopped; step++) {
+    pending.get();
+    if(step+1<schedule.size()) {
+      pending=std::async(std::launch::async, load, step+1, &buffers[(step+1)%2]);
+    }
+    const soa_points<C, DIM>& points=buffers[step%2];
+    size_t i=schedule[step].first;
+    size_t firstLen=std::min(len, (i+1)*block_len)-i*block_len;
+    std::vector<pair_block> blocks(
+      1,
+        schedule[step].first==schedule[step].second
+      ? pair_block(0, points.size())
+      : pair_block(0, firstLen, firstLen, points.size())
+    );
+    compute_distances_tiled<C, DIM>(points, blocks, calc, proto, sink, threads, tile_len);
+  }
+  if(pending.valid()) {
+    pending.wait();
+  }
+}
+
+// How histogram_filler computes all the pairs
+enum class fill_engine {
+  tiled,     // pair by pair, tile by tile (see compute_distances_tiled)
+  dual_tree, // node pair by node pair (see compute_distances_dualtree), for l2
+             // into a fixedl_histogram; tiled for anything else
+  fft_grid,  // approximate, by grid correlation (see compute_distances_fft), for
+             // planar l2 into a fixedl_histogram, whatever the number of pairs;
+             // as `tiled` (and sampled) for anything else
+  cell_list  // only the pairs within the histogram's range, by neighbouring
+             // cells (see compute_distances_celllist), for l2 into a
+             // fixedl_histogram; tiled for anything else
 };
 
-template <typename T>
-struct is_dereferencable_base<std::shared_ptr<T>> : public std::true_type
-{
-  using type=T;
-  static constexpr bool value=true;
+// Tunables for histogram_filler::start
+struct fill_options {
+  // workers for the computation, 0 - as many as the hardware supports
+  unsigned threads;
+  // side (in points) of the square tiles the i<j triangle is split into
+  size_t tile_len;
+  // samples per work unit, in the sampled mode
+  size_t chunk_len;
+  // of the sampled pairs; same seed, same samples
+  unsigned long long seed;
+  // when sampling, stop as soon as the fraction of every slot is
+  // known within +/-tolerance (95% confidence); 0 - take all the samples
+  double tolerance;
+  // of the exhaustive computation
+  fill_engine engine;
+  // cells per side of the fft_grid engine
+  size_t grid_len;
+  // of the computation's tasks on the shared compute_pool, against those
+  // of the other fillers running
+  job_priority priority;
+
+  fill_options(
+    unsigned threadCount=0, size_t tileLen=512, size_t chunkLen=65536,
+    unsigned long long seedVal=0, double tol=0, fill_engine engineKind=fill_engine::tiled,
+    size_t gridLen=1024, job_priority prio=job_priority::normal
+  ) :
+    threads(threadCount), tile_len(tileLen), chunk_len(chunkLen), seed(seedVal),
+    tolerance(tol), engine(engineKind), grid_len(gridLen), priority(prio)
+  {
+  }
 };
 
-template <typename T>
-struct is_dereferencable_base<std::weak_ptr<T>> : public std::true_type
-{
-  using type=T;
-  static constexpr bool value=true;
+// Where the time of a histogram_filler run goes (see histogram_filler::stats).
+// The workers compute the distances and bin them into private histograms in
+// parallel; handing those over is serialized: merging them into the filler's
+// histograms, then notifying the observer. The time of the run not spent
+// in the handoff counts as computing: merge+notify close to the elapsed
+// time means the workers are kept waiting by the handoff. Of the workers'
+// computing, the binning is timed apart (see tile_timing).
+struct fill_stats {
+  // not done, nor stopped
+  bool running;
+  // pairs (or samples) handed over so far, out of `total`
+  size_t pairs;
+  size_t total;
+  // since the start, up to the end if not running
+  double elapsed_seconds;
+  // of taking the snapshot of the points
+  double snapshot_seconds;
+  double compute_seconds;
+  // of the workers binning the distances, summed over the workers (so up
+  // to their number times the compute_seconds; see bin_seconds_per_worker)
+  double bin_seconds;
+  double merge_seconds;
+  // in the observer's partial_progress and done
+  double notify_seconds;
+  // of the last stop() or cancel(): from raising the flag to the end of the computation
+  double stop_seconds;
+  // the pairs handed over by each worker, in the order of their first handoff
+  std::vector<size_t> worker_pairs;
+  // what computed the pairs: sampled ones (pair by pair, whatever the
+  // engine), or all of them by the `engine` (the fill_options' one, unless
+  // it doesn't apply to the distance or the histogram and tiled took over)
+  bool sampled;
+  fill_engine engine;
+
+  fill_stats() :
+    running(false), pairs(0), total(0), elapsed_seconds(0), snapshot_seconds(0),
+    compute_seconds(0), bin_seconds(0), merge_seconds(0), notify_seconds(0), stop_seconds(0),
+    worker_pairs(), sampled(false), engine(fill_engine::tiled)
+  {
+  }
+
+  double pairs_per_second() const {
+    return this->elapsed_seconds>0 ? this->pairs/this->elapsed_seconds : 0;
+  }
+
+  // the bin_seconds of a worker on average (of those that handed pairs
+  // over), the same wall time as the compute_seconds it is part of
+  double bin_seconds_per_worker() const {
+    return this->worker_pairs.empty() ? 0 : this->bin_seconds/this->worker_pairs.size();
+  }
 };
 
-template <typename T>
-struct dereferencable :
-    public is_dereferencable_base<
-      typename std::remove_reference<
-        typename std::remove_cv<T>::type
-      >
-    >
-{
+namespace detail {
+
+// SFINAE check for the distance calculators equivalent to l2 over transformed points:
+// `npoint<C,DIM> whiten(const npoint<C,DIM>&) const` (see mahalanobis)
+template <class dist_type, typename C, size_t DIM>
+struct is_whitening_dist {
 private:
-  using nocv=typename std::remove_cv<T>::type;
-  using noref=typename std::remove_reference<nocv>::type;
+  template <typename T>
+  static constexpr auto check(T*) ->
+    typename std::is_same<
+      decltype(std::declval<const T&>().whiten(std::declval<const npoint<C,DIM>&>())),
+      npoint<C,DIM>
+    >::type;
+  template<typename>
+  static constexpr std::false_type check(...);
+
+  using response=decltype(check<dist_type>(static_cast<dist_type*>(nullptr)));
 public:
-  using type=typename is_dereferencable_base<noref>::type;
-  static constexpr bool value=is_dereferencable_base<noref>::value;
+  static constexpr bool value=response::value;
+};
 
-  static type* lock(type* x) { return x; };
+// compute_distances_fft, for the planar points only
+template <typename C, size_t DIM>
+struct grid_engine {
+  static constexpr bool enabled=false;
 
-  static std::shared_ptr<type> lock(std::shared_ptr<type>& x) { return x; }
-  static std::shared_ptr<type> lock(const std::shared_ptr<type>& x) { return x; };
+  template <class PointSupplier, class TileSink>
+  static void run(
+    const PointSupplier&, const std::vector<pair_block>&,
+    const fixedl_histogram<C>&, TileSink, const fill_options&
+  ) {
+  }
+};
 
-  static std::shared_ptr<type> lock(std::weak_ptr<type>& x) { return x.lock(); }
-  static std::shared_ptr<type> lock(const std::weak_ptr<type>& x) { return x.lock(); }
+template <typename C>
+struct grid_engine<C, 2> {
+  static constexpr bool enabled=true;
 
+  template <class PointSupplier, class TileSink>
+  static void run(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    const fixedl_histogram<C>& proto, TileSink tile_done, const fill_options& options
+  ) {
+    compute_distances_fft<C>(src, blocks, proto, tile_done, options.threads, options.grid_len);
+  }
 };
 
-template <typename C, size_t DIM>
-struct vec_adaptor : public std::vector<npoint<C, DIM>> {
-public:
-  using points_vec = std::vector<npoint<C, DIM>>;
+// Runs the engines with the distance calculator as is ...
+template <typename C, size_t DIM, class DistCalc, bool=is_whitening_dist<DistCalc, C, DIM>::value>
+struct dist_engines {
+  // if the grid engine takes the job, instead of the other two
+  static bool uses_grid(const histogram<C>& proto, const fill_options& options) {
+    return
+         fill_engine::fft_grid==options.engine && grid_engine<C, DIM>::enabled
+      && std::is_same<typename std::remove_const<DistCalc>::type, l2<C, DIM>>::value
+      && dynamic_cast<const fixedl_histogram<C>*>(&proto)
+    ;
+  }
 
-  vec_adaptor() = default;
-  vec_adaptor(const vec_adaptor& )=default;
-  vec_adaptor(vec_adaptor&& o) : points_vec(o) { }
+  template <class PointSupplier, class TileSink>
+  static void gridded(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    DistCalc&, const histogram<C>& proto, TileSink tile_done,
+    const fill_options& options
+  ) {
+    grid_engine<C, DIM>::run(
+      src, blocks, dynamic_cast<const fixedl_histogram<C>&>(proto), tile_done, options
+    );
+  }
+
+  // the engine of `exhaustive`: the options' one if it applies, tiled otherwise
+  static fill_engine exhaustive_engine(const histogram<C>& proto, const fill_options& options) {
+    bool plainL2=std::is_same<typename std::remove_const<DistCalc>::type, l2<C, DIM>>::value;
+    bool fixed=dynamic_cast<const fixedl_histogram<C>*>(&proto);
+    if(
+         plainL2 && fixed
+      && (fill_engine::dual_tree==options.engine || fill_engine::cell_list==options.engine)
+    ) {
+      return options.engine;
+    }
+    return fill_engine::tiled;
+  }
 
-  vec_adaptor& operator=(const vec_adaptor& ) = default;
-  vec_adaptor& operator=(vec_adaptor&& o) {
-    return points_vec::operator =(o);
+  // raising `cancelled` ends the dual-tree and cell-list preparations early
+  template <class PointSupplier, class TileSink>
+  static void exhaustive(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+    const fill_options& options, const std::atomic<bool>& cancelled
+  ) {
+    fill_engine engine=exhaustive_engine(proto, options);
+    if(fill_engine::dual_tree==engine) {
+      compute_distances_dualtree<C, DIM>(
+        src, blocks, dynamic_cast<const fixedl_histogram<C>&>(proto), tile_done,
+        options.threads, 262144, 0, &cancelled
+      );
+    }
+    else if(fill_engine::cell_list==engine) {
+      compute_distances_celllist<C, DIM>(
+        src, blocks, dynamic_cast<const fixedl_histogram<C>&>(proto), tile_done,
+        options.threads, 262144, 0, &cancelled
+      );
+    }
+    else {
+      compute_distances_tiled<C, DIM>(
+        src, blocks, calc, proto, tile_done, options.threads, options.tile_len
+      );
+    }
   }
 
-  const npoint<C, DIM>& operator()(size_t i) const {
-    return points_vec::at(i);
+  template <class PointSupplier, class TileSink>
+  static void sampled(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    const std::vector<size_t>& quotas,
+    DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+    const fill_options& options
+  ) {
+    compute_distances_sampled<C, DIM>(
+      src, blocks, quotas, calc, proto, tile_done,
+      options.threads, options.chunk_len, options.seed
+    );
   }
 };
 
+// ... or, for the whitening ones, as l2 (batch kernels and dual trees included)
+// over the whitened points, same indices as in `src`
+template <typename C, size_t DIM, class DistCalc>
+struct dist_engines<C, DIM, DistCalc, true> {
+  static bool uses_grid(const histogram<C>& proto, const fill_options& options) {
+    return dist_engines<C, DIM, l2<C, DIM>>::uses_grid(proto, options);
+  }
 
-} // namespace detail
+  static fill_engine exhaustive_engine(const histogram<C>& proto, const fill_options& options) {
+    return dist_engines<C, DIM, l2<C, DIM>>::exhaustive_engine(proto, options);
+  }
 
-// src - operator()(size_t i) to get the point at position i and size()
-//       with the result type assignable to a npoint<C,DIM>
-// DistCalc - dist_type operator()(const npoint<C,DIM>&, const npoint<C,DIM>) const
-// dest - a return of `false` signals "stop computations, I'll not listen anymore"
-template <
-  typename C, size_t DIM,
-  class PointSupplier, class DistCalc,
-  typename dist_type=double
-> void compute_distances(
-  const PointSupplier& src,
-  std::function<bool(dist_type)> dest, DistCalc& calc,
-  size_t max_dist_count=std::numeric_limits<size_t>::max()
-)
-// may throw() whatever the Supplier or dest throws.
-{
-  size_t plen=src.size();
-  if(plen>1) {
-    detail::dist_type_updater<DistCalc, PointSupplier>::update_dist(src, calc);
-    size_t maxDistCount=(plen*(plen-1)) >> 1;
-    if(maxDistCount>max_dist_count) {
-      // sampled
-      std::mt19937 rng;
-      rng.seed(std::chrono::high_resolution_clock::now().time_since_epoch().count());
-      std::uniform_int_distribution<size_t> distrib(0, plen-1);
-      for(size_t count=0; count < max_dist_count; count++) {
-        size_t i=distrib(rng), j=distrib(rng);
-        while(i==j) j=distrib(rng);
-        npoint<C,DIM> first=src(i), second=src(j);
-        if( !dest(calc(first,second)) ) {
-          break;
-        }
-      }
-    }
-    else { // exhaustive
-      for(size_t i=0; i<plen; i++) {
-        npoint<C,DIM> first=src(i);
-        for(size_t j=i+1; j<plen; j++) {
-          npoint<C,DIM> second=src(j);
-          if( !dest(calc(first,second)) ) {
-            return;
-          }
-        }
-      }
-    }
+  template <class PointSupplier, class TileSink>
+  static void gridded(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+    const fill_options& options
+  ) {
+    soa_points<C, DIM> whitened;
+    whiten(src, calc, whitened);
+    l2<C, DIM> plain;
+    dist_engines<C, DIM, l2<C, DIM>>::gridded(
+      whitened, blocks, plain, proto, tile_done, options
+    );
   }
-}
 
-// PointSupplier - size() and `void points_copy(Container& dest)`
-//                 with a Container class providing the `push_back(const npoint<CoordType, DIM>& point).
+  template <class PointSupplier, class TileSink>
+  static void exhaustive(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+    const fill_options& options, const std::atomic<bool>& cancelled
+  ) {
+    soa_points<C, DIM> whitened;
+    whiten(src, calc, whitened);
+    l2<C, DIM> plain;
+    dist_engines<C, DIM, l2<C, DIM>>::exhaustive(
+      whitened, blocks, plain, proto, tile_done, options, cancelled
+    );
+  }
+
+  template <class PointSupplier, class TileSink>
+  static void sampled(
+    const PointSupplier& src, const std::vector<pair_block>& blocks,
+    const std::vector<size_t>& quotas,
+    DistCalc& calc, const histogram<C>& proto, TileSink tile_done,
+    const fill_options& options
+  ) {
+    soa_points<C, DIM> whitened;
+    whiten(src, calc, whitened);
+    l2<C, DIM> plain;
+    dist_engines<C, DIM, l2<C, DIM>>::sampled(
+      whitened, blocks, quotas, plain, proto, tile_done, options
+    );
+  }
+
+private:
+  // the filler hands over a const calculator: update a copy
+  template <class PointSupplier>
+  static void whiten(const PointSupplier& src, const DistCalc& calc, soa_points<C, DIM>& dest) {
+    using calc_type=typename std::remove_const<DistCalc>::type;
+    calc_type updated(calc);
+    dist_type_updater<calc_type, PointSupplier>::update_dist(src, updated);
+    updated.whiten(src, dest);
+  }
+};
+
+} // namespace detail
+
+
+// PointSupplier - `snapshot()`, returning a shared_ptr to an immutable point supplier
+//                 (`size()`, `operator()(size_t)` and, for the batch kernels,
+//                 `coords(size_t)` - see bound_npoint_cloud)
 // DistCalculator - dist_type operator()(const npoint<C,DIM>&, const npoint<C,DIM>) const
 // Observer - void partial_progress(shared_ptr<histogram<CoordType>>, size_t progress, size_t total)
 //             invoked at every observerProgressTick
@@ -228,7 +1810,15 @@ template <
   class PointSupplier, class Observer
 >
 class histogram_filler {
+  using snapshot_type=
+    typename std::remove_cv<
+      typename decltype(std::declval<const PointSupplier&>().snapshot())::element_type
+    >::type
+  ;
 public:
+  using snapshot_ptr=std::shared_ptr<const snapshot_type>;
+  using histogram_ptr=std::shared_ptr<histogram<CoordType>>;
+
   // if/when the observer get recycled, the thread stops at the next observerProgressTick
   // unless stopped earlier by calling stop
 
@@ -237,7 +1827,10 @@ public:
     const std::shared_ptr<histogram<CoordType>>& toFill
   ) :
     histogram_(toFill),
-    eager_stop_flag_(false), done_(false), exec_()
+    eager_stop_flag_(false), done_(false), exec_(),
+    sampling_error_(0.0), converged_(false),
+    stats_lock_(), stats_(), started_(), worker_ids_(),
+    stop_pending_(false), stop_requested_()
   {
     assert(toFill);
   }
@@ -246,47 +1839,252 @@ public:
     this->stop();
   }
 
+  // Fills the histogram with the distances between the points of `src`:
+  // all of them or, if more than `maxDists`, `maxDists` random ones
+  // (fewer if converging within `options.tolerance` before).
+  // The work is spread over `options.threads` workers of the shared
+  // compute_pool, at `options.priority`.
   template <class DistCalculator, class ObserverPtr>
   void start(const PointSupplier& src, const DistCalculator& dist,
              ObserverPtr observer,
              double observerProgressTickPct,
-             size_t maxDists=std::numeric_limits<size_t>::max()
+             size_t maxDists=std::numeric_limits<size_t>::max(),
+             const fill_options& options=fill_options()
+  ) {
+    auto snapshotStart=std::chrono::steady_clock::now();
+    snapshot_ptr snapshot=src.snapshot();
+    double snapshotTime=seconds_since(snapshotStart);
+    std::vector<pair_block> blocks(1, pair_block(0, snapshot->size()));
+    // the single block histogram being the filler's one, it gets cleared
+    std::vector<histogram_ptr> blockHistograms(1, this->histogram_);
+    this->start_blocks(
+      snapshot, blocks, blockHistograms, dist, observer,
+      observerProgressTickPct, maxDists, options
+    );
+    this->record_snapshot_time(snapshotTime);
+  }
+
+  // Same as above, for only a part of the pairs of `snapshot`: fills
+  // `blockHistograms[k]` with the distances of `blocks[k]` and adds all of
+  // them to the histogram of this filler (which is not cleared; the caller may
+  // seed it with the contributions of the pairs not covered by `blocks`).
+  // When sampling, each block gets a share of `maxDists` proportional to the
+  // number of its pairs, as if sampling the whole snapshot. An early stop on
+  // convergence keeps the proportions, but leaves the blocks short of their
+  // share (don't mix them with blocks of full-share runs).
+  // Progress is reported against the number of pairs (or samples) in the blocks.
+  template <class DistCalculator, class ObserverPtr>
+  void start_blocks(
+    const snapshot_ptr& snapshot,
+    const std::vector<pair_block>& blocks,
+    const std::vector<histogram_ptr>& blockHistograms,
+    const DistCalculator& dist,
+    ObserverPtr observer,
+    double observerProgressTickPct,
+    size_t maxDists=std::numeric_limits<size_t>::max(),
+    const fill_options& options=fill_options()
   ) {
+    assert(blocks.size()==blockHistograms.size());
     while(!this->done_ && this->exec_.joinable()) {
       // if it's not joinable, it may be just inited .
       this->stop();
     }
-    this->histogram_->clear();
+    if(this->exec_.joinable()) {
+      this->exec_.join();
+    }
+    for(auto& h : blockHistograms) {
+      h->clear();
+    }
     this->eager_stop_flag_.store(false);
     this->done_=false;
-    this->startThreadProper(src, dist, observer, observerProgressTickPct, maxDists);
+    this->converged_.store(false);
+    this->startThreadProper(
+      snapshot, blocks, blockHistograms, dist, observer,
+      observerProgressTickPct, maxDists, options
+    );
   }
 
+  // Raises the stop flag and waits for the computation to end.
   void stop() {
-    // signal stop
-    this->eager_stop_flag_.store(true);
-    // wait for the thread to stop - should happen at the next cycle
+    this->cancel();
+    // should happen at the next cycle
     if(this->exec_.joinable()) {
       this->exec_.join();
+      this->record_stopped();
     }
   }
 
+  // Raises the stop flag, without waiting: the computation ends at its
+  // next cycle, notifying nobody. See running().
+  void cancel() {
+    {
+      std::unique_lock<std::mutex> barrier(this->stats_lock_);
+      if(this->stats_.running && !this->stop_pending_) {
+        this->stop_pending_=true;
+        this->stop_requested_=std::chrono::steady_clock::now();
+      }
+    }
+    this->eager_stop_flag_.store(true);
+  }
+
+  // whether the computation (if any) hasn't ended yet; doesn't wait
+  bool running() const {
+    return !this->exec_.ended();
+  }
+
   bool stopped() const {
     return this->eager_stop_flag_.load();
   }
 
+  // When sampling, the half-width of the 95% confidence interval of the
+  // least certain slot fraction of the histogram (so far); 0 if exhaustive
+  double sampling_error() const {
+    return this->sampling_error_.load();
+  }
+
+  // if done before taking all the samples, the tolerance being reached
+  bool converged() const {
+    return this->converged_.load();
+  }
+
   std::shared_ptr<histogram<CoordType>> get_histogram() const {
     return this->histogram_;
   }
 
+  // of the current (or last) run; cheap enough to poll
+  fill_stats stats() const {
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    fill_stats ret=this->stats_;
+    if(ret.running) {
+      ret.elapsed_seconds=seconds_since(this->started_);
+      ret.compute_seconds=
+        std::max(ret.elapsed_seconds-ret.merge_seconds-ret.notify_seconds, 0.0)
+      ;
+    }
+    return ret;
+  }
+
+  // For the callers of start_blocks, which take the snapshot themselves
+  void record_snapshot_time(double seconds) {
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    this->stats_.snapshot_seconds=seconds;
+  }
+
 private:
 
+  static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+  }
+
+  void reset_stats(size_t total, bool sampled, fill_engine engine) {
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    double stopTime=this->stats_.stop_seconds;
+    this->stats_=fill_stats();
+    this->stats_.running=true;
+    this->stats_.total=total;
+    this->stats_.sampled=sampled;
+    this->stats_.engine=engine;
+    this->stats_.stop_seconds=stopTime;
+    this->started_=std::chrono::steady_clock::now();
+    this->worker_ids_.clear();
+  }
+
+  // a handoff of `pairs` computed by the `worker` and binned in `binSeconds`,
+  // its merging started at `since`
+  void record_merge(
+    size_t pairs, std::thread::id worker, double binSeconds,
+    std::chrono::steady_clock::time_point since
+  ) {
+    double took=seconds_since(since);
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    size_t ix=
+        std::find(this->worker_ids_.begin(), this->worker_ids_.end(), worker)
+      - this->worker_ids_.begin()
+    ;
+    if(ix==this->worker_ids_.size()) {
+      this->worker_ids_.push_back(worker);
+      this->stats_.worker_pairs.push_back(0);
+    }
+    this->stats_.worker_pairs[ix]+=pairs;
+    this->stats_.pairs+=pairs;
+    this->stats_.bin_seconds+=binSeconds;
+    this->stats_.merge_seconds+=took;
+  }
+
+  void record_notify(std::chrono::steady_clock::time_point since) {
+    double took=seconds_since(since);
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    this->stats_.notify_seconds+=took;
+  }
+
+  // the end of a computation a stop was requested for
+  void record_stopped() {
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    if(this->stop_pending_) {
+      this->stop_pending_=false;
+      this->stats_.stop_seconds=seconds_since(this->stop_requested_);
+    }
+  }
+
+  void finish_stats() {
+    std::unique_lock<std::mutex> barrier(this->stats_lock_);
+    if(this->stats_.running) {
+      this->stats_.running=false;
+      this->stats_.elapsed_seconds=seconds_since(this->started_);
+      this->stats_.compute_seconds=std::max(
+        this->stats_.elapsed_seconds-this->stats_.merge_seconds-this->stats_.notify_seconds,
+        0.0
+      );
+    }
+  }
+
+  // To update the Observer, we need:
+  // - the observer must still be valid (if provided as weak_ptr for example)
+  // - the stop flag was not raised
+  // The compare_exchange_strong will be false if the stop_flag is not the expected false
+  //  (comparison doesn't succeed) - as we are using the strong version, no spurrios falses.
+  // If compare_exchange_strong is false (expectedStopFlag is true) which means
+  //   the stop flag was raised before
+  // If hasChange is true and expectedStopFlag is also true, it means
+  //   even if the stop flag was not raised before, the Observer is no longer valid
+  // One on top of the other, we can proceed with notifying only if
+  //   the expectedStopFlag is still false
+  template <class ObserverPtr>
+  void notify_progress(ObserverPtr& observer, size_t progressSoFar, size_t total) {
+    bool expectedStopFlag=false;
+    auto notification=detail::dereferencable<ObserverPtr>::lock(observer);
+    this->eager_stop_flag_.compare_exchange_strong(expectedStopFlag, !notification);
+    if(!expectedStopFlag) {
+      auto since=std::chrono::steady_clock::now();
+      notification->partial_progress(this->histogram_, progressSoFar, total);
+      this->record_notify(since);
+    }
+  }
+
+  template <class ObserverPtr>
+  void notify_done(ObserverPtr& observer) {
+    bool expectedStopFlag=false;
+    auto notification=detail::dereferencable<ObserverPtr>::lock(observer);
+    this->eager_stop_flag_.compare_exchange_strong(expectedStopFlag, !notification);
+    // the observer gets to see the final stats
+    this->finish_stats();
+    if(!expectedStopFlag) {
+      auto since=std::chrono::steady_clock::now();
+      notification->done(this->histogram_);
+      this->record_notify(since);
+    }
+    this->done_=true;
+  }
+
   template <class DistCalculator, class ObserverPtr> void startThreadProper(
-    const PointSupplier& src,
+    const snapshot_ptr& snapshot,
+    const std::vector<pair_block>& blocks,
+    const std::vector<histogram_ptr>& blockHistograms,
     DistCalculator& distCalc,
     ObserverPtr observer,
     double observerProgressTickPct,
-    size_t maxDists
+    size_t maxDists,
+    const fill_options& options
   )
   {
     static_assert(
@@ -294,109 +2092,153 @@ private:
       std::is_same<Observer, typename detail::dereferencable<ObserverPtr>::type>::value,
       "The observer param must be dereferencable to the `Observer` type"
     );
-    detail::vec_adaptor<CoordType, DIM> points;
-    src.points_copy(points);
-    size_t len=points.size();
-    if(len) {
-      if(maxDists>len*(len-1)/2) {
-        // more distances than what can be obtained from the available points
-        maxDists=len*(len-1)/2;
-      }
-      size_t observerProgressTick=
-          observerProgressTickPct>0
-        ? maxDists*observerProgressTickPct
-        : std::numeric_limits<size_t>::max()
-      ;
+    using engines=detail::dist_engines<CoordType, DIM, DistCalculator>;
+    size_t len=snapshot->size();
+    size_t pairCount=triangle_pairs(len);
+    // the grid takes in all the pairs at once
+    bool gridded=engines::uses_grid(*this->histogram_, options);
+    bool sampled=(maxDists<pairCount) && !gridded;
+    std::vector<size_t> quotas;
+    size_t total=0;
+    for(const pair_block& block : blocks) {
+      size_t blockPairs=block.pair_count();
+      size_t quota=blockPairs;
+      if(sampled) {
+        quota=
+            blockPairs==pairCount
+          ? maxDists
+          : static_cast<size_t>(
+              static_cast<long double>(blockPairs)*maxDists/pairCount+0.5
+            )
+        ;
+      }
+      quotas.push_back(quota);
+      total+=quota;
+    }
+    this->sampling_error_.store(sampled ? slot_error(*this->histogram_) : 0.0);
+    bool adaptive=sampled && options.tolerance>0;
+    this->reset_stats(
+      total, sampled,
+      gridded ? fill_engine::fft_grid : engines::exhaustive_engine(*this->histogram_, options)
+    );
+    if(0==total) {
+      // no pairs of points: job done before starting it
+      // but we still need another thread for reporting
+      // the thread-start and result reportng are protected by a
+      // unique lock (non-reentrant)
+      auto reporter=[this, observer]() mutable {
+        this->notify_done(observer);
+      };
+      this->exec_=compute_pool::shared().post(reporter);
+      return;
+    }
+    size_t observerProgressTick=
+        observerProgressTickPct>0
+      ? std::max(size_t(total*observerProgressTickPct), size_t(1))
+      : std::numeric_limits<size_t>::max()
+    ;
+    // the computation thread shares the snapshot, no matter how the PointSupplier changes
+    auto threadFunc= [=]() mutable {
+      compute_pool::priority_scope urgency(options.priority);
+      const snapshot_type& points=*snapshot;
       size_t progressSoFar=0;
       size_t nextNotification=observerProgressTick;
-      auto collector=[
-        progressSoFar, nextNotification, maxDists, observerProgressTick,
-        observer, this
-      ] (CoordType reported) mutable {
-        bool ret=(maxDists>progressSoFar);
-        if(!ret) {
+      // the blocks and the tiles are reported in bulk
+      auto tileDone=[&](
+        size_t blockIx, const histogram<CoordType>& partial, size_t pairs, bool balanced
+      ) {
+        auto handoff=std::chrono::steady_clock::now();
+        const histogram_ptr& blockHistogram=blockHistograms[blockIx];
+        blockHistogram->merge(partial);
+        if(blockHistogram!=this->histogram_) {
+          this->histogram_->merge(partial);
+        }
+        progressSoFar+=pairs;
+        if(sampled && balanced) {
+          this->sampling_error_.store(slot_error(*this->histogram_));
+        }
+        this->record_merge(pairs, tile_timing::worker(), tile_timing::bin_seconds(), handoff);
+        if(progressSoFar>=total) {
+          this->notify_done(observer);
           return false;
         }
-        progressSoFar++;
-        this->histogram_->add_sample(reported);
-        nextNotification--;
-        bool expectedStopFlag=false;
-        if(maxDists<=progressSoFar) {
-          // last notification
-          auto notification=detail::dereferencable<ObserverPtr>::lock(observer);
-          // to update the Observer, we need:
-          // - the observer must still be valid (if provided as weak_ptr for example)
-          // - the stop flag was not raised
-          // The compare_exchange_strong will be false if the stop_flag is not the expected false
-          //  (comparison doesn't succeed) - as we are using the strong version, no spurrios falses.
-          // If compare_exchange_strong is false (expectedStopFlag is true) which means
-          //   the stop flag was raised before
-          // If hasChange is true and expectedStopFlag is also true, it means
-          //   even if the stop flag was not raised before, the Observer is no longer valid
-          // One on top of the other, we can proceed with notifying only if
-          //   the expectedStopFlag is still false
-          expectedStopFlag=false;
-          this->eager_stop_flag_.compare_exchange_strong(expectedStopFlag, !notification);
-          if(!expectedStopFlag) {
-            notification->done(this->histogram_);
-          }
-          this->done_=true;
-          return false; // no other distances expected or will be accepted
+        if(adaptive && balanced && this->sampling_error_.load()<=options.tolerance) {
+          this->converged_.store(true);
+          this->notify_done(observer);
+          return false;
         }
-        else if(! nextNotification ) { // must notify the observer on partial progress
-          expectedStopFlag=false;
-          auto notification=detail::dereferencable<ObserverPtr>::lock(observer);
-          this->eager_stop_flag_.compare_exchange_strong(expectedStopFlag, !notification);
-          if(!expectedStopFlag) {
-            notification->partial_progress(this->histogram_, progressSoFar, maxDists);
+        if(progressSoFar>=nextNotification) {
+          this->notify_progress(observer, progressSoFar, total);
+          nextNotification=progressSoFar+observerProgressTick;
+          if(nextNotification<progressSoFar) { // overflow
+            nextNotification=std::numeric_limits<size_t>::max();
           }
-          nextNotification=observerProgressTick;
         }
-        // check again the flag
-        expectedStopFlag=false;
-        this->eager_stop_flag_.compare_exchange_strong(expectedStopFlag, false);
-        ret= !expectedStopFlag;
-        if(expectedStopFlag) {  // prematurely stopped
+        bool ret=!this->eager_stop_flag_.load();
+        if(!ret) {  // prematurely stopped
           this->done_=true;
         }
         return ret;
       };
-      std::function<bool(CoordType)> coll(collector);
-      auto threadFunc= [=]() mutable {
-        try {
-          compute_distances<
-            CoordType, DIM,
-            detail::vec_adaptor<CoordType, DIM>, DistCalculator
-          >(points, coll, distCalc, maxDists);
+      try {
+        if(gridded) {
+          engines::gridded(
+            points, blocks, distCalc, *this->histogram_, tileDone, options
+          );
         }
-        catch(...) {
-          this->eager_stop_flag_.store(true);
-          this->done_=true;
+        else if(sampled) {
+          engines::sampled(
+            points, blocks, quotas, distCalc, *this->histogram_, tileDone, options
+          );
         }
-      };
-      this->exec_=std::thread(threadFunc);
-    }
-    else { // no points in the supplier: job done before starting it
-      // but we still nee to create another thread for reporting
-      // the thread-start and result reportng are protected by a
-      // unique lock (non-reentrant)
-      auto reporter=[this, observer]() {
-        auto notification=detail::dereferencable<ObserverPtr>::lock(observer);
-        bool expectedStopFlag=false;
-        this->eager_stop_flag_.compare_exchange_strong(expectedStopFlag, !notification);
-        if(!expectedStopFlag) {
-          notification->done(this->histogram_);
+        else {
+          engines::exhaustive(
+            points, blocks, distCalc, *this->histogram_, tileDone, options,
+            this->eager_stop_flag_
+          );
+        }
+        if(this->eager_stop_flag_.load()) {  // stopped before any tile_done
+          this->done_=true;
         }
+      }
+      catch(...) {
+        this->eager_stop_flag_.store(true);
         this->done_=true;
-      };
-      this->exec_=std::thread(reporter);
+      }
+      this->finish_stats();
+      this->record_stopped();
+    };
+    this->exec_=compute_pool::shared().post(threadFunc);
+  }
+
+  // Agresti-Coull interval (two pseudo-samples in and two out of the slot),
+  // so that the yet empty slots don't pass as certain
+  static double slot_error(const histogram<CoordType>& h) {
+    double n=h.total_count()+4.0;
+    double worst=0;
+    for(size_t i=0; i<h.num_slots(); i++) {
+      double p=(h.slot_count(i)+2.0)/n;
+      worst=std::max(worst, p*(1-p));
     }
+    return 1.96*std::sqrt(worst/n);
   }
 
   std::shared_ptr<histogram<CoordType>> histogram_;
   std::atomic<bool> eager_stop_flag_;
   bool done_;
-  std::thread exec_;
+  // the computation, on a thread of the shared compute_pool
+  pool_job exec_;
+  std::atomic<double> sampling_error_;
+  std::atomic<bool> converged_;
+  // guards all below
+  mutable std::mutex stats_lock_;
+  fill_stats stats_;
+  std::chrono::steady_clock::time_point started_;
+  // the workers met so far, the index in the stats_.worker_pairs
+  std::vector<std::thread::id> worker_ids_;
+  // a stop requested, not yet reached; when
+  bool stop_pending_;
+  std::chrono::steady_clock::time_point stop_requested_;
 };
 
 
@@ -0,0 +1,151 @@
+/*
+ * File:   rng.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace distspctr {
+
+// Philox4x32-10 (Salmon et al. - "Parallel random numbers: as easy as 1, 2, 3"):
+// a keyed bijection over 128-bit counters. The n-th block of a stream
+// is computed straight from n, so any worker can produce any part of
+// any stream without going through the preceding numbers.
+struct philox4x32 {
+  using counter_type=std::array<std::uint32_t, 4>;
+  using key_type=std::array<std::uint32_t, 2>;
+
+  static counter_type block(counter_type ctr, key_type key) {
+    for(int r=0; r<10; r++) {
+      if(r) {
+        key[0]+=0x9E3779B9u;
+        key[1]+=0xBB67AE85u;
+      }
+      std::uint64_t p0=std::uint64_t(0xD2511F53u)*ctr[0];
+      std::uint64_t p1=std::uint64_t(0xCD9E8D57u)*ctr[2];
+      ctr={{
+        std::uint32_t(p1>>32)^ctr[1]^key[0], std::uint32_t(p1),
+        std::uint32_t(p0>>32)^ctr[3]^key[1], std::uint32_t(p0)
+      }};
+    }
+    return ctr;
+  }
+
+  // the `index`-th 128 bits of the `stream` keyed by `seed`, as two 64-bit values
+  static void block(
+    std::uint64_t seed, std::uint64_t stream, std::uint64_t index,
+    std::uint64_t (&dest)[2]
+  ) {
+    counter_type ctr={{
+      std::uint32_t(index), std::uint32_t(index>>32),
+      std::uint32_t(stream), std::uint32_t(stream>>32)
+    }};
+    key_type key={{std::uint32_t(seed), std::uint32_t(seed>>32)}};
+    counter_type out=philox4x32::block(ctr, key);
+    dest[0]=(std::uint64_t(out[1])<<32) | out[0];
+    dest[1]=(std::uint64_t(out[3])<<32) | out[2];
+  }
+};
+
+// Uniform in [0, n) from 64 random bits: the high half of bits*n
+// (biased by at most n/2^64, no rejection)
+inline std::uint64_t uniform_below(std::uint64_t bits, std::uint64_t n) {
+  std::uint64_t bLo=bits & 0xFFFFFFFFu, bHi=bits>>32;
+  std::uint64_t nLo=n & 0xFFFFFFFFu, nHi=n>>32;
+  std::uint64_t lolo=bLo*nLo, lohi=bLo*nHi, hilo=bHi*nLo, hihi=bHi*nHi;
+  std::uint64_t mid=(lolo>>32)+(lohi & 0xFFFFFFFFu)+(hilo & 0xFFFFFFFFu);
+  return hihi+(lohi>>32)+(hilo>>32)+(mid>>32);
+}
+
+// n*(n-1)/2, the number of unordered pairs of n points, without the
+// overflow of n*(n-1) (from ~4.3e9 points on, with 64 bits)
+inline std::uint64_t triangle_pairs(std::uint64_t n) {
+  return (n & 1) ? n*((n-1)/2) : (n/2)*(n ? n-1 : 0);
+}
+
+// The `p`-th unordered pair i<j in the order (0,1), (0,2), (1,2), (0,3), ...
+// p in [0, triangle_pairs(n)) covers the pairs of n points.
+inline void unordered_pair(std::uint64_t p, std::uint64_t& i, std::uint64_t& j) {
+  // triangle_pairs(j) <= p < triangle_pairs(j+1); the double estimate may be one off
+  std::uint64_t k=static_cast<std::uint64_t>((1.0+std::sqrt(1.0+8.0*static_cast<double>(p)))/2);
+  while(k>1 && triangle_pairs(k)>p) {
+    k--;
+  }
+  while(triangle_pairs(k+1)<=p) {
+    k++;
+  }
+  j=k;
+  i=p-triangle_pairs(k);
+}
+
+// UniformRandomBitGenerator over a Philox stream, to feed the std:: distributions
+class philox_engine {
+public:
+  using result_type=std::uint32_t;
+
+  explicit philox_engine(std::uint64_t seedVal=0, std::uint64_t stream=0) :
+    seed_(seedVal), stream_(stream), index_(0), buffer_(), used_(4)
+  {
+  }
+
+  void seed(std::uint64_t seedVal, std::uint64_t stream=0) {
+    this->seed_=seedVal;
+    this->stream_=stream;
+    this->index_=0;
+    this->used_=4;
+  }
+
+  static constexpr result_type min() {
+    return 0;
+  }
+
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    if(this->used_>=4) {
+      philox4x32::counter_type ctr={{
+        std::uint32_t(this->index_), std::uint32_t(this->index_>>32),
+        std::uint32_t(this->stream_), std::uint32_t(this->stream_>>32)
+      }};
+      philox4x32::key_type key={{std::uint32_t(this->seed_), std::uint32_t(this->seed_>>32)}};
+      this->buffer_=philox4x32::block(ctr, key);
+      this->index_++;
+      this->used_=0;
+    }
+    return this->buffer_[this->used_++];
+  }
+
+  void discard(unsigned long long count) {
+    while(count && this->used_<4) {
+      this->used_++;
+      count--;
+    }
+    this->index_+=count/4;
+    this->used_=4;
+    for(count%=4; count; count--) {
+      (*this)();
+    }
+  }
+
+private:
+  std::uint64_t seed_;
+  std::uint64_t stream_;
+  std::uint64_t index_;
+  philox4x32::counter_type buffer_;
+  unsigned used_;
+};
+
+} // namespace distspctr
+
+#endif /* RNG_HPP */
@@ -0,0 +1,179 @@
+/*
+ * File:   simd.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(__AVX__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Batch kernels over structure-of-arrays point blocks: DIM columns of
+// contiguous coordinates, `cols[d][k]` being the d-th coordinate of the k-th point.
+// The instruction set is the one the compiler targets: AVX-512F, then AVX(+FMA),
+// then SSE2, with a plain loop for whatever remains (or for other CPUs).
+// Build with `CONFIG+=native_simd` (see distspectrum.pro) to get the wide ones.
+
+namespace distspctr {
+
+namespace simd {
+
+namespace detail {
+
+// Register-wide operations for `C` in registers of `Bytes` width
+template <typename C, size_t Bytes> struct pack {
+  static constexpr bool enabled=false;
+};
+
+#if defined(__AVX512F__)
+template <> struct pack<float, 64> {
+  static constexpr bool enabled=true;
+  using reg=__m512;
+  static reg load(const float* p) { return _mm512_loadu_ps(p); }
+  static void store(float* p, reg v) { _mm512_storeu_ps(p, v); }
+  static reg set1(float v) { return _mm512_set1_ps(v); }
+  static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+  static reg sqrt(reg a) { return _mm512_sqrt_ps(a); }
+};
+
+template <> struct pack<double, 64> {
+  static constexpr bool enabled=true;
+  using reg=__m512d;
+  static reg load(const double* p) { return _mm512_loadu_pd(p); }
+  static void store(double* p, reg v) { _mm512_storeu_pd(p, v); }
+  static reg set1(double v) { return _mm512_set1_pd(v); }
+  static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+  static reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+};
+#endif
+
+#if defined(__AVX__)
+template <> struct pack<float, 32> {
+  static constexpr bool enabled=true;
+  using reg=__m256;
+  static reg load(const float* p) { return _mm256_loadu_ps(p); }
+  static void store(float* p, reg v) { _mm256_storeu_ps(p, v); }
+  static reg set1(float v) { return _mm256_set1_ps(v); }
+  static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__)
+  static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+  static reg fmadd(reg a, reg b, reg c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+  static reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+};
+
+template <> struct pack<double, 32> {
+  static constexpr bool enabled=true;
+  using reg=__m256d;
+  static reg load(const double* p) { return _mm256_loadu_pd(p); }
+  static void store(double* p, reg v) { _mm256_storeu_pd(p, v); }
+  static reg set1(double v) { return _mm256_set1_pd(v); }
+  static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__)
+  static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+  static reg fmadd(reg a, reg b, reg c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+  static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+};
+#endif
+
+#if defined(__SSE2__)
+template <> struct pack<float, 16> {
+  static constexpr bool enabled=true;
+  using reg=__m128;
+  static reg load(const float* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, reg v) { _mm_storeu_ps(p, v); }
+  static reg set1(float v) { return _mm_set1_ps(v); }
+  static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+};
+
+template <> struct pack<double, 16> {
+  static constexpr bool enabled=true;
+  using reg=__m128d;
+  static reg load(const double* p) { return _mm_loadu_pd(p); }
+  static void store(double* p, reg v) { _mm_storeu_pd(p, v); }
+  static reg set1(double v) { return _mm_set1_pd(v); }
+  static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+  static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+};
+#endif
+
+// Processes [from, count) in steps of the register width; returns where it stopped
+template <typename C, size_t DIM, bool root, size_t Bytes, bool=pack<C, Bytes>::enabled>
+struct l2_run {
+  static size_t run(const C*, const C* const*, size_t from, size_t, C*) {
+    return from;
+  }
+};
+
+template <typename C, size_t DIM, bool root, size_t Bytes>
+struct l2_run<C, DIM, root, Bytes, true> {
+  static size_t run(const C* p, const C* const* cols, size_t from, size_t count, C* out) {
+    using P=pack<C, Bytes>;
+    const size_t lanes=Bytes/sizeof(C);
+    typename P::reg centre[DIM];
+    for(size_t d=0; d<DIM; d++) {
+      centre[d]=P::set1(p[d]);
+    }
+    size_t k=from;
+    for(; k+lanes<=count; k+=lanes) {
+      typename P::reg diff=P::sub(P::load(cols[0]+k), centre[0]);
+      typename P::reg acc=P::mul(diff, diff);
+      for(size_t d=1; d<DIM; d++) {
+        diff=P::sub(P::load(cols[d]+k), centre[d]);
+        acc=P::fmadd(diff, diff, acc);
+      }
+      if(root) {
+        acc=P::sqrt(acc);
+      }
+      P::store(out+k, acc);
+    }
+    return k;
+  }
+};
+
+} // namespace detail
+
+// out[k] = squared L2 distance between `p` and the k-th point of the block
+// (or the plain distance if `root`), for k in [0, count)
+template <typename C, size_t DIM, bool root>
+void l2_batch(const C* p, const C* const* cols, size_t count, C* out) {
+  size_t k=0;
+  k=detail::l2_run<C, DIM, root, 64>::run(p, cols, k, count, out);
+  k=detail::l2_run<C, DIM, root, 32>::run(p, cols, k, count, out);
+  k=detail::l2_run<C, DIM, root, 16>::run(p, cols, k, count, out);
+  for(; k<count; k++) {
+    C acc=0;
+    for(size_t d=0; d<DIM; d++) {
+      C diff=cols[d][k]-p[d];
+      acc+=diff*diff;
+    }
+    out[k]=root ? std::sqrt(acc) : acc;
+  }
+}
+
+} // namespace simd
+
+} // namespace distspctr
+
+#endif /* SIMD_HPP */
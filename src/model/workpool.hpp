@@ -0,0 +1,489 @@
+/*
+ * File:   workpool.hpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+#ifndef WORKPOOL_HPP
+#define WORKPOOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace distspctr {
+
+// How urgent a batch of tasks is. The workers of a compute_pool serve the
+// most urgent batch waiting and, between two tasks, leave a batch for a
+// more urgent one.
+enum class job_priority {
+  background,  // e.g. a reference spectrum
+  normal,
+  interactive  // recomputed as the user edits
+};
+
+// Handle of a compute_pool::post job; join() waits for it to end.
+// Same use as a std::thread running the job.
+class pool_job {
+  friend class compute_pool;
+public:
+  pool_job() : state_() {}
+
+  bool joinable() const {
+    return static_cast<bool>(this->state_);
+  }
+
+  // whether the job returned (true if none); doesn't wait
+  bool ended() const {
+    if(!this->state_) {
+      return true;
+    }
+    std::unique_lock<std::mutex> barrier(this->state_->lock);
+    return this->state_->done;
+  }
+
+  void join() {
+    if(this->state_) {
+      std::unique_lock<std::mutex> barrier(this->state_->lock);
+      this->state_->ended.wait(barrier, [this]() { return this->state_->done; });
+      barrier.unlock();
+      this->state_.reset();
+    }
+  }
+
+private:
+  struct job_state {
+    std::mutex lock;
+    std::condition_variable ended;
+    bool done;
+
+    job_state() : lock(), ended(), done(false) {}
+  };
+
+  std::shared_ptr<job_state> state_;
+};
+
+// A set of long-lived workers running batches of independent tasks.
+// Within a batch, each worker index owns a deque of tasks: consumed from
+// the front by its holder and, once out of work, the holder steals from
+// the back of the others' deques. The tasks are given the index (in
+// [0, width) of their batch) so that they can use per-worker private state;
+// an index is held by one thread at a time.
+// Batches run concurrently. The workers take the tasks of the most
+// urgent batch first; the thread running a batch (see run) waits while
+// a more urgent batch has tasks left, so that the latter gets the cores.
+// Meant to be shared (see shared()), so that the threads are created once.
+class compute_pool {
+public:
+  using task_type=std::function<void(unsigned)>;
+
+  // 0 threads means "as many as the hardware supports". When `pinned`,
+  // worker k is bound to the core k (modulo the cores), on Linux only.
+  explicit compute_pool(unsigned threads=0, bool pinned=false) :
+    threads_(threads), pinned_(pinned), lock_(), wake_(), stopping_(false),
+    batches_(), workers_(), driver_wake_(), driver_jobs_(), drivers_(), driving_(0)
+  {
+    if(0==this->threads_) {
+      this->threads_=std::max(1u, std::thread::hardware_concurrency());
+    }
+    unsigned cores=std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned k=0; k<this->threads_; k++) {
+      this->workers_.emplace_back([this]() { this->work(); });
+      if(this->pinned_) {
+        pin(this->workers_.back(), k % cores);
+      }
+    }
+  }
+
+  compute_pool(const compute_pool&) = delete;
+  compute_pool& operator=(const compute_pool&) = delete;
+
+  // waits for the posted jobs to end
+  ~compute_pool() {
+    {
+      std::unique_lock<std::mutex> barrier(this->lock_);
+      this->stopping_=true;
+    }
+    this->wake_.notify_all();
+    this->driver_wake_.notify_all();
+    for(auto& t : this->workers_) {
+      t.join();
+    }
+    for(auto& t : this->drivers_) {
+      t.join();
+    }
+  }
+
+  unsigned threads() const {
+    return this->threads_;
+  }
+
+  bool pinned() const {
+    return this->pinned_;
+  }
+
+  // Runs all the tasks to completion on at most `width` worker indices at
+  // a time (0 - threads()), the calling thread holding the index 0.
+  // The tasks are dealt in contiguous chunks, so that neighbouring tasks
+  // (likely to share data) start on the same index.
+  // may throw() the first exception a task throws, after all the tasks
+  // started have ended; the tasks not yet started at the moment of the
+  // throw are dropped.
+  void run(std::vector<task_type>& tasks, unsigned width, job_priority priority) {
+    if(tasks.empty()) {
+      return;
+    }
+    batch job(priority, 0==width ? this->threads_ : width);
+    size_t len=tasks.size();
+    size_t chunk=(len+job.width-1)/job.width;
+    for(unsigned w=0; w<job.width; w++) {
+      size_t b=std::min(len, w*chunk), e=std::min(len, b+chunk);
+      for(size_t i=b; i<e; i++) {
+        job.queues[w].push_back(std::move(tasks[i]));
+      }
+    }
+    job.pending=len;
+    job.held[0]=true;
+    job.active=1;
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->batches_.push_back(&job);
+    this->wake_.notify_all();
+    while(true) {
+      this->serve(job, 0, barrier, true);
+      if(0==job.pending) {
+        break;
+      }
+      this->wake_.wait(barrier, [this, &job]() {
+        return 0==job.pending || !this->outranked(job, true);
+      });
+    }
+    job.active--;
+    this->wake_.wait(barrier, [&job]() { return 0==job.active; });
+    this->batches_.erase(std::find(this->batches_.begin(), this->batches_.end(), &job));
+    barrier.unlock();
+    if(job.error) {
+      std::rethrow_exception(job.error);
+    }
+  }
+
+  // Runs `job` on a thread of its own, outside the workers: for the
+  // computations driving run(), which would otherwise keep a worker
+  // blocked. The threads are kept for later jobs, one created only
+  // when all the others are busy.
+  pool_job post(std::function<void()> job) {
+    pool_job ret;
+    ret.state_=std::make_shared<pool_job::job_state>();
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->driver_jobs_.emplace_back(std::move(job), ret.state_);
+    if(this->drivers_.size()<this->driving_+this->driver_jobs_.size()) {
+      this->drivers_.emplace_back([this]() { this->drive(); });
+    }
+    else {
+      this->driver_wake_.notify_one();
+    }
+    return ret;
+  }
+
+  // The pool of the model layer, created at the first call.
+  static compute_pool& shared() {
+    shared_config& config=shared_state();
+    std::unique_lock<std::mutex> barrier(config.lock);
+    if(!config.pool) {
+      config.pool.reset(new compute_pool(config.threads, config.pinned));
+    }
+    return *config.pool;
+  }
+
+  // The threads and pinning of the shared() pool; false (and no effect)
+  // once that's created.
+  static bool configure_shared(unsigned threads, bool pinned) {
+    shared_config& config=shared_state();
+    std::unique_lock<std::mutex> barrier(config.lock);
+    if(config.pool) {
+      return false;
+    }
+    config.threads=threads;
+    config.pinned=pinned;
+    return true;
+  }
+
+  // The priority of the batches run by the calling thread, see priority_scope
+  static job_priority current_priority() {
+    return thread_priority();
+  }
+
+  // Sets the priority of the batches run by the calling thread, for its lifetime
+  class priority_scope {
+  public:
+    explicit priority_scope(job_priority priority) : previous_(thread_priority()) {
+      thread_priority()=priority;
+    }
+
+    ~priority_scope() {
+      thread_priority()=this->previous_;
+    }
+
+    priority_scope(const priority_scope&) = delete;
+    priority_scope& operator=(const priority_scope&) = delete;
+
+  private:
+    job_priority previous_;
+  };
+
+private:
+  struct batch {
+    job_priority priority;
+    unsigned width;
+    std::vector<std::deque<task_type>> queues;
+    // the indices taken by a thread
+    std::vector<bool> held;
+    size_t pending;
+    // the threads serving the batch, its runner included
+    unsigned active;
+    std::exception_ptr error;
+
+    batch(job_priority prio, unsigned widthVal) :
+      priority(prio), width(widthVal), queues(widthVal), held(widthVal, false),
+      pending(0), active(0), error()
+    {
+    }
+  };
+
+  struct shared_config {
+    std::mutex lock;
+    unsigned threads;
+    bool pinned;
+    std::unique_ptr<compute_pool> pool;
+
+    shared_config() : lock(), threads(0), pinned(false), pool() {}
+  };
+
+  static shared_config& shared_state() {
+    static shared_config ret;
+    return ret;
+  }
+
+  static job_priority& thread_priority() {
+    static thread_local job_priority ret=job_priority::normal;
+    return ret;
+  }
+
+  static void pin(std::thread& t, unsigned core) {
+#if defined(__linux__)
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    pthread_setaffinity_np(t.native_handle(), sizeof(cores), &cores);
+#else
+    (void)t;
+    (void)core;
+#endif
+  }
+
+  // the index of `job` a worker can take, 0 (the runner's) if none
+  static unsigned free_index(const batch& job) {
+    for(unsigned w=1; w<job.width; w++) {
+      if(!job.held[w]) {
+        return w;
+      }
+    }
+    return 0;
+  }
+
+  // (lock held) Whether a more urgent batch than `job` has tasks left
+  // (and, for a worker, an index to take).
+  bool outranked(const batch& job, bool runner) const {
+    for(const batch* other : this->batches_) {
+      if(
+           other->priority>job.priority && other->pending>0
+        && (runner || 0!=free_index(*other))
+      ) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // (lock held) The most urgent batch a worker can join, the earliest
+  // among equals; nullptr if none.
+  batch* next_batch() const {
+    batch* ret=nullptr;
+    for(batch* job : this->batches_) {
+      if(
+           job->pending>0 && 0!=free_index(*job)
+        && (!ret || job->priority>ret->priority)
+      ) {
+        ret=job;
+      }
+    }
+    return ret;
+  }
+
+  // (lock held)
+  bool next_task(batch& job, unsigned index, task_type& dest) {
+    if(0==job.pending) {
+      return false;
+    }
+    std::deque<task_type>& own=job.queues[index];
+    if(!own.empty()) {
+      dest=std::move(own.front());
+      own.pop_front();
+    }
+    else {
+      for(unsigned i=1; i<job.width; i++) {
+        std::deque<task_type>& victim=job.queues[(index+i) % job.width];
+        if(!victim.empty()) {
+          dest=std::move(victim.back());
+          victim.pop_back();
+          break;
+        }
+      }
+    }
+    if(0==--job.pending) {
+      // the batch no longer outranks the others
+      this->wake_.notify_all();
+    }
+    return true;
+  }
+
+  // (lock held) Runs the tasks of `job` as `index`, until none is left or a
+  // more urgent batch waits; the lock released while running a task.
+  void serve(batch& job, unsigned index, std::unique_lock<std::mutex>& barrier, bool runner) {
+    task_type task;
+    while(!this->outranked(job, runner) && this->next_task(job, index, task)) {
+      std::exception_ptr error;
+      barrier.unlock();
+      try {
+        task(index);
+      }
+      catch(...) {
+        error=std::current_exception();
+      }
+      task=nullptr;
+      barrier.lock();
+      if(error) {
+        if(!job.error) {
+          job.error=error;
+        }
+        for(auto& q : job.queues) {
+          q.clear();
+        }
+        job.pending=0;
+        this->wake_.notify_all();
+      }
+    }
+  }
+
+  void work() {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    while(true) {
+      batch* job=nullptr;
+      this->wake_.wait(barrier, [this, &job]() {
+        job=this->next_batch();
+        return this->stopping_ || job;
+      });
+      if(!job) {
+        return;
+      }
+      unsigned index=free_index(*job);
+      job->held[index]=true;
+      job->active++;
+      this->serve(*job, index, barrier, false);
+      job->held[index]=false;
+      job->active--;
+      // the runner may wait for the batch to end, other workers for the index
+      this->wake_.notify_all();
+    }
+  }
+
+  void drive() {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    while(true) {
+      this->driver_wake_.wait(barrier, [this]() {
+        return this->stopping_ || !this->driver_jobs_.empty();
+      });
+      if(this->driver_jobs_.empty()) {
+        return;
+      }
+      std::function<void()> job=std::move(this->driver_jobs_.front().first);
+      std::shared_ptr<pool_job::job_state> state=this->driver_jobs_.front().second;
+      this->driver_jobs_.pop_front();
+      this->driving_++;
+      barrier.unlock();
+      job();
+      job=nullptr;
+      {
+        std::unique_lock<std::mutex> ended(state->lock);
+        state->done=true;
+      }
+      state->ended.notify_all();
+      barrier.lock();
+      this->driving_--;
+    }
+  }
+
+  unsigned threads_;
+  bool pinned_;
+  // guards all below but the threads
+  std::mutex lock_;
+  std::condition_variable wake_;
+  bool stopping_;
+  std::vector<batch*> batches_;
+  std::vector<std::thread> workers_;
+  std::condition_variable driver_wake_;
+  std::deque<std::pair<std::function<void()>, std::shared_ptr<pool_job::job_state>>> driver_jobs_;
+  std::vector<std::thread> drivers_;
+  // the posted jobs running
+  size_t driving_;
+};
+
+// A batch of tasks for the shared compute_pool, run at the priority of the
+// calling thread (see compute_pool::priority_scope).
+// The tasks are given the index of the worker running them (in [0, workers()) )
+// so that they can use per-worker private state.
+class work_stealing_pool {
+public:
+  using task_type=compute_pool::task_type;
+
+  // 0 workers means as many as the threads of the shared pool
+  explicit work_stealing_pool(unsigned workers=0) :
+    pool_(compute_pool::shared()), workers_(workers)
+  {
+    if(0==this->workers_) {
+      this->workers_=this->pool_.threads();
+    }
+  }
+
+  work_stealing_pool(const work_stealing_pool&) = delete;
+  work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+  unsigned workers() const {
+    return this->workers_;
+  }
+
+  // See compute_pool::run; the calling thread acts as worker 0.
+  void run(std::vector<task_type>& tasks) {
+    this->pool_.run(tasks, this->workers_, compute_pool::current_priority());
+  }
+
+private:
+  compute_pool& pool_;
+  unsigned workers_;
+};
+
+} // namespace distspctr
+
+#endif /* WORKPOOL_HPP */
@@ -0,0 +1,221 @@
+/*
+ * File:   lookup_test.cpp
+ * Author: acolomitchi
+ *
+ * Created on 17 October 2026
+ */
+
+// The slot lookup of fixedl_histogram (arithmetic estimate plus one
+// correction step) against the plain binary search over the thresholds
+// it replaced: every threshold and its nextafter neighbours, min, max and
+// the values just outside the range, in the linear and the squared domain,
+// over a spread of slot counts and ranges, float and double.
+// Prints the mismatches and a summary; exits with 1 if there were any.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "../model/model.hpp"
+
+namespace {
+
+// the thresholds as the histogram computes them, start value of each slot
+template <typename C> std::vector<C> thresholds_of(size_t slotCount, C min, C max) {
+  std::vector<C> ret(slotCount);
+  for(size_t i=0; i<slotCount; i++) {
+    long double x=static_cast<long double>(i)/slotCount;
+    ret[i]=static_cast<C>((1-x)*min+x*max);
+  }
+  return ret;
+}
+
+// the baseline lookup: first threshold not below `val`, the last
+// slot also taking what's above its threshold
+template <typename C> size_t baseline_slot(const std::vector<C>& thresholds, C val) {
+  size_t ix=std::lower_bound(thresholds.begin(), thresholds.end(), val)-thresholds.begin();
+  return std::min(ix, thresholds.size()-1);
+}
+
+// each value, its neighbours towards -inf and +inf
+template <typename C> void add_probes(std::vector<C>& probes, C val) {
+  probes.push_back(std::nextafter(val, -std::numeric_limits<C>::infinity()));
+  probes.push_back(val);
+  probes.push_back(std::nextafter(val, std::numeric_limits<C>::infinity()));
+}
+
+struct check_counts {
+  size_t cases;
+  size_t probes;
+  size_t mismatches;
+
+  check_counts() : cases(0), probes(0), mismatches(0) { }
+};
+
+template <typename C> void report(
+  check_counts& counts, const char* domain, size_t slotCount, C min, C max,
+  C probe, long expected, long actual
+) {
+  counts.mismatches++;
+  if(counts.mismatches<=20) {
+    std::cout.precision(std::numeric_limits<C>::max_digits10);
+    std::cout
+      << "MISMATCH " << domain << " (" << sizeof(C) << " bytes) slots=" << slotCount
+      << " range=[" << min << ", " << max << "] probe=" << probe
+      << " expected=" << expected << " got=" << actual << std::endl
+    ;
+  }
+}
+
+// -1 below the range, -2 above it, otherwise the slot
+template <typename C> long baseline_linear(const std::vector<C>& thresholds, C min, C max, C val) {
+  if(!(val>=min)) {
+    return -1;
+  }
+  if(val>max) {
+    return -2;
+  }
+  return static_cast<long>(baseline_slot(thresholds, val));
+}
+
+template <typename C> void check_linear(check_counts& counts, size_t slotCount, C min, C max) {
+  std::vector<C> thresholds=thresholds_of(slotCount, min, max);
+  std::vector<C> probes;
+  for(C t : thresholds) {
+    add_probes(probes, t);
+  }
+  add_probes(probes, min);
+  add_probes(probes, max);
+
+  distspctr::fixedl_histogram<C> single(slotCount, min, max);
+  distspctr::fixedl_histogram<C> bulk(slotCount, min, max);
+  std::vector<size_t> expectedCounts(slotCount, 0);
+  size_t expectedOverflow=0, expectedTotal=0;
+  for(C val : probes) {
+    long expected=baseline_linear(thresholds, min, max, val);
+    size_t before=(expected>=0) ? single.slot_count(expected) : 0;
+    size_t totalBefore=single.total_count();
+    size_t overflowBefore=single.overflow_count();
+    single.add_sample(val);
+    long actual;
+    if(single.total_count()==totalBefore) {
+      actual=-1;
+    }
+    else if(single.overflow_count()!=overflowBefore) {
+      actual=-2;
+    }
+    else if(expected>=0 && single.slot_count(expected)==before+1) {
+      actual=expected;
+    }
+    else {
+      // landed elsewhere: find where
+      actual=-3;
+      for(size_t k=0; k<slotCount; k++) {
+        if(single.slot_count(k)!=expectedCounts[k]) {
+          actual=static_cast<long>(k);
+          break;
+        }
+      }
+    }
+    if(actual!=expected) {
+      report(counts, "linear", slotCount, min, max, val, expected, actual);
+      return;
+    }
+    if(expected>=0) {
+      expectedCounts[expected]++;
+      expectedTotal++;
+    }
+    else if(-2==expected) {
+      expectedOverflow++;
+      expectedTotal++;
+    }
+    counts.probes++;
+  }
+  // the bulk adds must count the same
+  bulk.add_samples(probes.data(), probes.size());
+  for(size_t k=0; k<slotCount; k++) {
+    if(bulk.slot_count(k)!=expectedCounts[k]) {
+      report(counts, "bulk", slotCount, min, max, thresholds[k],
+             static_cast<long>(expectedCounts[k]), static_cast<long>(bulk.slot_count(k)));
+      return;
+    }
+  }
+  if(bulk.overflow_count()!=expectedOverflow || bulk.total_count()!=expectedTotal) {
+    report(counts, "bulk totals", slotCount, min, max, max,
+           static_cast<long>(expectedTotal), static_cast<long>(bulk.total_count()));
+    return;
+  }
+  counts.cases++;
+}
+
+template <typename C> void check_squared(check_counts& counts, size_t slotCount, C min, C max) {
+  std::vector<C> thresholds=thresholds_of(slotCount, min, max);
+  std::vector<C> sqThresholds(slotCount);
+  for(size_t i=0; i<slotCount; i++) {
+    long double t=thresholds[i];
+    sqThresholds[i]=static_cast<C>(t*t);
+  }
+  C sqMin=static_cast<C>(static_cast<long double>(min)*min);
+  C sqMax=static_cast<C>(static_cast<long double>(max)*max);
+  std::vector<C> probes;
+  for(C t : sqThresholds) {
+    add_probes(probes, t);
+  }
+  add_probes(probes, sqMin);
+  add_probes(probes, sqMax);
+
+  distspctr::fixedl_histogram<C> hist(slotCount, min, max);
+  for(C sqVal : probes) {
+    long expected=baseline_linear(sqThresholds, sqMin, sqMax, sqVal);
+    size_t slot=0;
+    int where=hist.locate_squared(sqVal, slot);
+    long actual=(0==where) ? static_cast<long>(slot) : (where<0 ? -1 : -2);
+    if(actual!=expected) {
+      report(counts, "squared", slotCount, min, max, sqVal, expected, actual);
+      return;
+    }
+    counts.probes++;
+  }
+  counts.cases++;
+}
+
+template <typename C> void check_all(check_counts& counts) {
+  const size_t slotCounts[]={
+    1, 2, 3, 7, 10, 64, 100, 255, 256, 1000, 1024, 3000, 4096, 10000, 65536
+  };
+  const C ranges[][2]={
+    {C(0), C(1)},
+    {C(0), C(1.4142135623730951)},
+    {C(0), C(1.3453)},
+    {C(0.1), C(0.67)},
+    {C(1e-3), C(1e3)},
+    {C(-0.2), C(1.3)},
+    {C(-3), C(-1)},
+  };
+  for(size_t n : slotCounts) {
+    for(const auto& r : ranges) {
+      check_linear(counts, n, r[0], r[1]);
+      if(r[0]>=0) {
+        check_squared(counts, n, r[0], r[1]);
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  check_counts floats, doubles;
+  check_all<float>(floats);
+  check_all<double>(doubles);
+  std::cout
+    << "float: " << floats.cases << " cases, " << floats.probes << " probes, "
+    << floats.mismatches << " mismatches" << std::endl
+    << "double: " << doubles.cases << " cases, " << doubles.probes << " probes, "
+    << doubles.mismatches << " mismatches" << std::endl
+  ;
+  return (floats.mismatches+doubles.mismatches) ? 1 : 0;
+}
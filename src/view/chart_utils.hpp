@@ -1,12 +1,15 @@
 #ifndef CHART_UTILS_HPP
 #define CHART_UTILS_HPP
 
+#include <chrono>
+#include <map>
 #include <mutex>
 #include <vector>
 
 #include <QObject>
 
 #include "2d.hpp"
+#include "../model/analytic.hpp"
 #include "../model/proc.hpp"
 
 
@@ -17,11 +20,45 @@ public:
   using point_cloud=distspctr::bbox_npoint_cloud<PointCluster, coord_type, 2>;
 private:
   using histogram_type=distspctr::fixedl_histogram<coord_type>;
+
+  // The observer of one update: tags the notifications of its filler with
+  // the generation of the update, the late ones of a superseded update
+  // being dropped (see jobProgress). The filler holds it weakly and stops
+  // by itself once the collector lets go of it.
+  class fill_job {
+  public:
+    fill_job(DiffHistogramCollector* owner, bool baseline, unsigned long long generation) :
+      owner_(owner), baseline_(baseline), generation_(generation)
+    {
+    }
+
+    void partial_progress(
+      std::shared_ptr<distspctr::histogram<coord_type>> hist,
+      size_t progress, size_t total_dists
+    ) {
+      this->owner_->jobProgress(*this, hist, progress/double(total_dists), false);
+    }
+
+    void done(std::shared_ptr<distspctr::histogram<coord_type>> hist) {
+      this->owner_->jobProgress(*this, hist, 1.0, true);
+    }
+
+    bool baseline() const {
+      return this->baseline_;
+    }
+
+    unsigned long long generation() const {
+      return this->generation_;
+    }
+
+  private:
+    DiffHistogramCollector* owner_;
+    bool baseline_;
+    unsigned long long generation_;
+  };
+
   using filler_type=
-    distspctr::histogram_filler<
-      coord_type, 2, point_cloud,
-      DiffHistogramCollector<ChartSeriesType, DistType>
-    >
+    distspctr::histogram_filler<coord_type, 2, point_cloud, fill_job>
   ;
 protected:
 
@@ -30,8 +67,15 @@ protected:
     size_t histogramSlots=100
   ) :
     baseline_(baseline), experimental_(experimental), histo_slots_(histogramSlots),
-    baseline_data_(), experimental_data_(), diff_(), lock_(),
-    baseline_filler_(), experimental_filler_()
+    baseline_data_(), baseline_progress_(0), baseline_error_(0),
+    experimental_data_(), experimental_progress_(0), experimental_error_(0),
+    diff_(), lock_(),
+    baseline_filler_(), experimental_filler_(), fill_options_(),
+    baseline_job_(), experimental_job_(), baseline_generation_(0), experimental_generation_(0),
+    retired_(),
+    pair_cache_(), pending_pairs_(), cached_sampling_(0, 0),
+    intra_cache_(), pending_intra_(), max_distance_(0),
+    baseline_stop_seconds_(0), experimental_stop_seconds_(0)
   {
     assert(histogramSlots>0);
     const p2d &blineMin=baseline.bbox_min(), &blineMax=baseline.bbox_max();
@@ -47,62 +91,298 @@ protected:
     this->computeData(dummy, this->diff_);
   }
 
+  // Neither waits for the filler's thread, see retire.
   void stopBaselineUpdate() {
-    if(this->baseline_filler_) {
-      this->baseline_filler_->stop();
-      this->baseline_filler_.reset();
-    }
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->retire(true);
   }
 
   void stopExperimentalUpdate() {
-    if(this->experimental_filler_) {
-      this->experimental_filler_->stop();
-      this->experimental_filler_.reset();
-    }
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->retire(false);
   }
 
   void triggerBaselineUpdate(
     DistType& distance, double progressTickPercent,
     size_t maxDistanceCount=std::numeric_limits<size_t>::max()
   ) {
-    if(this->baseline_filler_) {
-      this->baseline_filler_->stop();
-    }
     // until the new thread is properly started, refuse
     // to handle another request for change
     std::unique_lock<std::mutex> barrier(this->lock_);
+    this->retire(true);
     std::shared_ptr<histogram_type> histogram=
         std::make_shared<histogram_type>(
-          this->histo_slots_, 0, this->baseline_.diag_len()
+          this->histo_slots_, 0, this->spectrumMax(this->baseline_)
         )
     ;
+    // the reference: yields the cores to the experimental updates
+    distspctr::fill_options options=this->fill_options_;
+    options.priority=distspctr::job_priority::background;
+    this->baseline_job_=std::make_shared<fill_job>(this, true, this->baseline_generation_);
     this->baseline_filler_=std::make_shared<filler_type>(histogram);
     this->baseline_filler_->start(
-        this->baseline_, distance, this,
-        progressTickPercent, maxDistanceCount
+        this->baseline_, distance, std::weak_ptr<fill_job>(this->baseline_job_),
+        progressTickPercent, maxDistanceCount, options
+    );
+  }
+
+  // Of the sampled distances; the ones already computed with another
+  // seed are dropped, re-trigger the updates to get them recomputed.
+  void setSamplingSeed(unsigned long long seed) {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    if(seed!=this->fill_options_.seed) {
+      this->fill_options_.seed=seed;
+      this->pair_cache_.clear();
+      this->intra_cache_.clear();
+    }
+  }
+
+  // See distspctr::fill_engine; the distances already computed by
+  // another engine are dropped, re-trigger the updates to get them recomputed.
+  void setFillEngine(distspctr::fill_engine engine) {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    if(engine!=this->fill_options_.engine) {
+      this->fill_options_.engine=engine;
+      this->pair_cache_.clear();
+      this->intra_cache_.clear();
+    }
+  }
+
+  // Truncates the spectra to the distances up to `maxDistance` (0 - up to
+  // the diagonal of the bbox); the longer ones are counted only in aggregate
+  // (see fixedl_histogram::overflow_count), so the slot fractions stay those
+  // of all the distances. Drops the spectra computed with another range,
+  // re-trigger the updates to get them recomputed.
+  void setMaxDistance(coord_type maxDistance) {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    if(maxDistance!=this->max_distance_) {
+      this->max_distance_=maxDistance;
+      this->pair_cache_.clear();
+      this->intra_cache_.clear();
+    }
+  }
+
+  // See distspctr::fill_options::tolerance; applies from the next trigger
+  void setSamplingTolerance(double tolerance) {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->fill_options_.tolerance=tolerance;
+  }
+
+  // The baseline as the L2 spectrum of points uniformly spread over the
+  // baseline's bbox, from the closed form instead of sampled
+  void triggerAnalyticBaseline() {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->retire(true);
+    std::shared_ptr<histogram_type> histogram=
+        std::make_shared<histogram_type>(
+          this->histo_slots_, 0, this->spectrumMax(this->baseline_)
+        )
+    ;
+    const p2d &bboxMin=this->baseline_.bbox_min(), &bboxMax=this->baseline_.bbox_max();
+    distspctr::fill_rect_spectrum<coord_type>(
+      *histogram, bboxMax[0]-bboxMin[0], bboxMax[1]-bboxMin[1]
     );
+    this->baseline_progress_=1.0;
+    this->baseline_error_=0.0;
+    this->processUpdate(histogram, this->baseline_data_);
   }
 
+  // The experimental spectrum is the sum of the spectra of its cluster
+  // pairs (intra- and inter-cluster); only the pairs involving a cluster
+  // that changed since the last update get recomputed.
   void triggerExperimentalUpdate(
     DistType& distance, double progressTickPercent,
     size_t maxDistanceCount=std::numeric_limits<size_t>::max()
   ) {
-    if(this->experimental_filler_) {
-      this->experimental_filler_->stop();
-    }
     // until the new thread is properly started, refuse
     // to handle another request for change
     std::unique_lock<std::mutex> barrier(this->lock_);
+    this->retire(false);
+    auto snapshotStart=std::chrono::steady_clock::now();
+    auto snapshot=this->experimental_.snapshot();
+    double snapshotTime=
+      std::chrono::duration<double>(std::chrono::steady_clock::now()-snapshotStart).count()
+    ;
+    size_t len=snapshot->size();
+    size_t pairCount=distspctr::triangle_pairs(len);
+    // the sampled spectra of the parts add up only if sampled at the same rate
+    std::pair<size_t, size_t> sampling(0, 0);
+    if(maxDistanceCount<pairCount) {
+      sampling=std::make_pair(maxDistanceCount, pairCount);
+    }
+    // the runs stopping early on convergence leave the blocks short of their
+    // share of samples, by varying amounts: nothing to reuse
+    bool adaptive=(sampling.first && this->fill_options_.tolerance>0);
+    if(sampling!=this->cached_sampling_ || adaptive) {
+      this->pair_cache_.clear();
+      this->intra_cache_.clear();
+      this->cached_sampling_=sampling;
+    }
+    std::shared_ptr<histogram_type> histogram=
+        std::make_shared<histogram_type>(
+          this->histo_slots_, 0, this->spectrumMax(this->experimental_)
+        )
+    ;
+    std::vector<distspctr::pair_block> blocks;
+    std::vector<typename filler_type::histogram_ptr> blockHistograms;
+    pair_histograms current;
+    this->pending_pairs_.clear();
+    this->pending_intra_.clear();
+    size_t clusters=snapshot->supplier_count();
+    for(size_t a=0; a<clusters; a++) {
+      for(size_t b=a; b<clusters; b++) {
+        cluster_pair key(
+          snapshot->supplier(a), snapshot->supplier_version(a),
+          snapshot->supplier(b), snapshot->supplier_version(b)
+        );
+        auto cached=this->pair_cache_.find(key);
+        const intra_spectrum* moved=nullptr;
+        double factor=1.0;
+        if(cached!=this->pair_cache_.end()) {
+          histogram->merge(*cached->second);
+          current.insert(*cached);
+        }
+        else if(
+             a==b && (moved=this->movedIntraSpectrum(*snapshot, a, factor))
+          && 1.0==factor
+        ) {
+          // rigidly moved; a rescaled one is only good enough for the previews
+          histogram->merge(*moved->histogram);
+          current[key]=moved->histogram;
+        }
+        else {
+          std::shared_ptr<histogram_type> part=
+              std::make_shared<histogram_type>(
+                this->histo_slots_, 0, this->spectrumMax(this->experimental_)
+              )
+          ;
+          blocks.push_back(
+              a==b
+            ? distspctr::pair_block(snapshot->begin_of(a), snapshot->end_of(a))
+            : distspctr::pair_block(
+                snapshot->begin_of(a), snapshot->end_of(a),
+                snapshot->begin_of(b), snapshot->end_of(b)
+              )
+          );
+          blockHistograms.push_back(part);
+          this->pending_pairs_[key]=part;
+          if(a==b && allPointsIn(*snapshot, a)) {
+            const PointCluster* cluster=snapshot->supplier(a);
+            this->pending_intra_[cluster]=
+                intra_spectrum(cluster->metricEpoch(), cluster->metricScale(), part)
+            ;
+          }
+        }
+      }
+    }
+    // drops the pairs of the clusters that changed or are gone
+    this->pair_cache_.swap(current);
+    for(auto it=this->intra_cache_.begin(); it!=this->intra_cache_.end(); ) {
+      if(snapshot->index_of(it->first)<clusters) {
+        ++it;
+      }
+      else {
+        it=this->intra_cache_.erase(it);
+      }
+    }
+    // follows the edits of the user
+    distspctr::fill_options options=this->fill_options_;
+    options.priority=distspctr::job_priority::interactive;
+    this->experimental_job_=
+      std::make_shared<fill_job>(this, false, this->experimental_generation_)
+    ;
+    this->experimental_filler_=std::make_shared<filler_type>(histogram);
+    this->experimental_filler_->start_blocks(
+          snapshot, blocks, blockHistograms, distance,
+          std::weak_ptr<fill_job>(this->experimental_job_),
+          progressTickPercent, maxDistanceCount, options
+    );
+    this->experimental_filler_->record_snapshot_time(snapshotTime);
+  }
+
+  // A quick approximation of the experimental spectrum, for while the points
+  // keep changing: `maxDistanceCount` distances sampled over the whole cloud,
+  // notified only when done. The intra-cluster spectra of the clusters moved
+  // rigidly or uniformly scaled since their full update are taken from the
+  // cache instead (rescaled, see fixedl_histogram::add_scaled), weighted to
+  // the sampling rate; the samples go to the other pairs. Nothing gets
+  // cached. Superseded, as any update, by the next trigger.
+  void triggerExperimentalPreview(DistType& distance, size_t maxDistanceCount) {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    this->retire(false);
+    // of the update superseded, no longer completing
+    this->pending_pairs_.clear();
+    this->pending_intra_.clear();
+    auto snapshotStart=std::chrono::steady_clock::now();
+    auto snapshot=this->experimental_.snapshot();
+    double snapshotTime=
+      std::chrono::duration<double>(std::chrono::steady_clock::now()-snapshotStart).count()
+    ;
+    size_t pairCount=distspctr::triangle_pairs(snapshot->size());
+    long double rate=
+        maxDistanceCount<pairCount
+      ? static_cast<long double>(maxDistanceCount)/pairCount
+      : 1.0L
+    ;
+    // of the cached intra-cluster spectra; unknown if the runs stopped on convergence
+    long double cachedRate=
+        this->cached_sampling_.first
+      ? static_cast<long double>(this->cached_sampling_.first)/this->cached_sampling_.second
+      : 1.0L
+    ;
+    bool cachedUsable=!(this->cached_sampling_.first && this->fill_options_.tolerance>0);
     std::shared_ptr<histogram_type> histogram=
         std::make_shared<histogram_type>(
-          this->histo_slots_, 0, this->experimental_.diag_len()
+          this->histo_slots_, 0, this->spectrumMax(this->experimental_)
         )
     ;
+    std::vector<distspctr::pair_block> blocks;
+    std::vector<typename filler_type::histogram_ptr> blockHistograms;
+    size_t clusters=snapshot->supplier_count();
+    for(size_t a=0; a<clusters; a++) {
+      for(size_t b=a; b<clusters; b++) {
+        const intra_spectrum* moved=nullptr;
+        double factor=1.0;
+        if(
+             a==b && cachedUsable && (moved=this->movedIntraSpectrum(*snapshot, a, factor))
+          // shrinking brings in some of the truncated distances, which are not known
+          && (factor>=1.0 || !moved->histogram->overflow_count())
+        ) {
+          // from the computed one, so that the rescaling errors don't pile up
+          histogram->add_scaled(
+            *moved->histogram, static_cast<coord_type>(factor), rate/cachedRate
+          );
+          continue;
+        }
+        blocks.push_back(
+            a==b
+          ? distspctr::pair_block(snapshot->begin_of(a), snapshot->end_of(a))
+          : distspctr::pair_block(
+              snapshot->begin_of(a), snapshot->end_of(a),
+              snapshot->begin_of(b), snapshot->end_of(b)
+            )
+        );
+        blockHistograms.push_back(
+          std::make_shared<histogram_type>(
+            this->histo_slots_, 0, this->spectrumMax(this->experimental_)
+          )
+        );
+      }
+    }
+    distspctr::fill_options options=this->fill_options_;
+    options.priority=distspctr::job_priority::interactive;
+    // the budget is small already
+    options.tolerance=0;
+    this->experimental_job_=
+      std::make_shared<fill_job>(this, false, this->experimental_generation_)
+    ;
     this->experimental_filler_=std::make_shared<filler_type>(histogram);
-    this->experimental_filler_->start(
-          this->experimental_, distance, this,
-          progressTickPercent, maxDistanceCount
+    this->experimental_filler_->start_blocks(
+        snapshot, blocks, blockHistograms, distance,
+        std::weak_ptr<fill_job>(this->experimental_job_),
+        0, maxDistanceCount, options
     );
+    this->experimental_filler_->record_snapshot_time(snapshotTime);
   }
 
   virtual void processUpdate(std::shared_ptr<distspctr::histogram<coord_type>> hist, std::vector<QPointF>& dest) {
@@ -122,7 +402,60 @@ protected:
 
 public:
 
-  virtual ~DiffHistogramCollector() {}
+  // waits for the fillers' threads, which notify this
+  virtual ~DiffHistogramCollector() {
+    std::vector<std::shared_ptr<filler_type>> fillers;
+    {
+      std::unique_lock<std::mutex> barrier(this->lock_);
+      this->retire(true);
+      this->retire(false);
+      for(auto& retired : this->retired_) {
+        fillers.push_back(retired.second);
+      }
+      this->retired_.clear();
+    }
+    for(auto& filler : fillers) {
+      filler->stop();
+    }
+  }
+
+  unsigned long long samplingSeed() const {
+    return this->fill_options_.seed;
+  }
+
+  double samplingTolerance() const {
+    return this->fill_options_.tolerance;
+  }
+
+  distspctr::fill_engine fillEngine() const {
+    return this->fill_options_.engine;
+  }
+
+  coord_type maxDistance() const {
+    return this->max_distance_;
+  }
+
+  // the sampling errors of the last updates (see histogram_filler::sampling_error)
+  void samplingErrors(qreal& experimental, qreal& baseline) const {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    experimental=this->experimental_error_;
+    baseline=this->baseline_error_;
+  }
+
+  // of the current (or last) updates (see histogram_filler::stats), with
+  // the stop times of the last updates interrupted (known once their
+  // threads ended)
+  void fillStats(distspctr::fill_stats& experimental, distspctr::fill_stats& baseline) const {
+    std::unique_lock<std::mutex> barrier(this->lock_);
+    experimental=
+      this->experimental_filler_ ? this->experimental_filler_->stats() : distspctr::fill_stats()
+    ;
+    experimental.stop_seconds=this->experimental_stop_seconds_;
+    baseline=
+      this->baseline_filler_ ? this->baseline_filler_->stats() : distspctr::fill_stats()
+    ;
+    baseline.stop_seconds=this->baseline_stop_seconds_;
+  }
 
   size_t experimentalSeries(ChartSeriesType& dest, qreal& progPct, qreal* min=0, qreal* max=0) const {
     progPct=this->experimental_progress_;
@@ -138,48 +471,137 @@ public:
     return this->toSeries(this->diff_, dest, min, max);
   }
 
-  // those two would benefit from a wrapper class
-  void partial_progress(
-    std::shared_ptr<distspctr::histogram<coord_type>> hist,
-    size_t progress, size_t total_dists
+private:
+
+  // A notification of `job`, under the lock_: dropped if the update got
+  // superseded since, whatever got computed in the meantime.
+  void jobProgress(
+    const fill_job& job, const std::shared_ptr<distspctr::histogram<coord_type>>& hist,
+    double progress, bool finished
   ) {
     std::unique_lock<std::mutex> barrier(this->lock_);
-    if(
-         this->baseline_filler_
-      && hist==this->baseline_filler_->get_histogram()
-    ) {
-      this->baseline_progress_=progress/double(total_dists);
+    bool baseline=job.baseline();
+    const std::shared_ptr<filler_type>& filler=
+      baseline ? this->baseline_filler_ : this->experimental_filler_
+    ;
+    unsigned long long current=
+      baseline ? this->baseline_generation_ : this->experimental_generation_
+    ;
+    if(job.generation()!=current || !filler) {
+      return;
+    }
+    if(baseline) {
+      this->baseline_progress_=progress;
+      this->baseline_error_=filler->sampling_error();
       this->processUpdate(hist, this->baseline_data_);
+      return;
     }
-    if(
-         this->experimental_filler_
-      && hist==this->experimental_filler_->get_histogram()
-    ){
-      this->experimental_progress_=progress/double(total_dists);
-      this->processUpdate(hist, this->experimental_data_);
+    this->experimental_progress_=progress;
+    this->experimental_error_=filler->sampling_error();
+    this->processUpdate(hist, this->experimental_data_);
+    if(finished) {
+      // the parts are complete, can be reused
+      this->pair_cache_.insert(this->pending_pairs_.begin(), this->pending_pairs_.end());
+      this->pending_pairs_.clear();
+      for(auto& intra : this->pending_intra_) {
+        this->intra_cache_[intra.first]=intra.second;
+      }
+      this->pending_intra_.clear();
     }
   }
 
-  void done(std::shared_ptr<distspctr::histogram<coord_type>> hist) {
-    std::unique_lock<std::mutex> barrier(this->lock_);
-    if(
-         this->baseline_filler_
-      && hist==this->baseline_filler_->get_histogram()
-    ) {
-      this->baseline_progress_=1.0;
-      this->processUpdate(hist, this->baseline_data_);
+  // (lock_ held) Supersedes the current baseline (or experimental) update,
+  // without waiting for its filler: the generation moves on, the filler
+  // is cancelled and kept among the retired_ until its thread ends.
+  void retire(bool baseline) {
+    std::shared_ptr<filler_type>& filler=
+      baseline ? this->baseline_filler_ : this->experimental_filler_
+    ;
+    (baseline ? this->baseline_generation_ : this->experimental_generation_)++;
+    (baseline ? this->baseline_job_ : this->experimental_job_).reset();
+    if(filler) {
+      filler->cancel();
+      this->retired_.push_back(std::make_pair(baseline, filler));
+      filler.reset();
     }
-    if(
-         this->experimental_filler_
-      && hist==this->experimental_filler_->get_histogram()
-    ) {
-      this->experimental_progress_=1.0;
-      this->processUpdate(hist, this->experimental_data_);
+    // drops the retired fillers done by now, destroying them doesn't wait
+    for(auto it=this->retired_.begin(); it!=this->retired_.end(); ) {
+      if(it->second->running()) {
+        ++it;
+        continue;
+      }
+      (it->first ? this->baseline_stop_seconds_ : this->experimental_stop_seconds_)=
+        it->second->stats().stop_seconds
+      ;
+      it=this->retired_.erase(it);
     }
   }
 
+  // identifies the points of two clusters, as read in a given snapshot version
+  struct cluster_pair {
+    const PointCluster* first;
+    unsigned long long first_version;
+    const PointCluster* second;
+    unsigned long long second_version;
 
-private:
+    cluster_pair(
+      const PointCluster* a, unsigned long long aVersion,
+      const PointCluster* b, unsigned long long bVersion
+    ) : first(a), first_version(aVersion), second(b), second_version(bVersion)
+    {
+    }
+
+    bool operator<(const cluster_pair& o) const {
+      if(this->first!=o.first) return std::less<const PointCluster*>()(this->first, o.first);
+      if(this->first_version!=o.first_version) return this->first_version<o.first_version;
+      if(this->second!=o.second) return std::less<const PointCluster*>()(this->second, o.second);
+      return this->second_version<o.second_version;
+    }
+  };
+
+  using pair_histograms=std::map<cluster_pair, std::shared_ptr<histogram_type>>;
+
+  // the intra-cluster spectrum of all the points of a cluster, as
+  // computed in a PointCluster::metricEpoch() and at a metricScale()
+  struct intra_spectrum {
+    unsigned long long epoch;
+    double scale;
+    std::shared_ptr<histogram_type> histogram;
+
+    intra_spectrum() : epoch(0), scale(1.0), histogram() { }
+
+    intra_spectrum(unsigned long long e, double s, std::shared_ptr<histogram_type> h)
+      : epoch(e), scale(s), histogram(h)
+    {
+    }
+  };
+
+  using snapshot_type=typename point_cloud::snapshot_type;
+
+  // none of the cluster's points left outside the cloud's bbox
+  static bool allPointsIn(const snapshot_type& snapshot, size_t ix) {
+    return snapshot.end_of(ix)-snapshot.begin_of(ix)==snapshot.supplier(ix)->size();
+  }
+
+  // If the cluster's points moved only rigidly or got uniformly scaled since
+  // its intra-cluster spectrum was computed (and no point left or entered the
+  // cloud's bbox), the cached spectrum, with the `factor` of the scaling
+  // (1 if rigid). Null otherwise.
+  const intra_spectrum* movedIntraSpectrum(
+    const snapshot_type& snapshot, size_t ix, double& factor
+  ) const {
+    const PointCluster* cluster=snapshot.supplier(ix);
+    auto found=this->intra_cache_.find(cluster);
+    if(
+         found==this->intra_cache_.end()
+      || found->second.epoch!=cluster->metricEpoch()
+      || !allPointsIn(snapshot, ix)
+    ) {
+      return nullptr;
+    }
+    factor=cluster->metricScale()/found->second.scale;
+    return &found->second;
+  }
 
   size_t toSeries(
     const std::vector<QPointF>& src, ChartSeriesType& dest,
@@ -211,6 +633,12 @@ private:
     return len;
   }
 
+  // the upper bound of the spectra of `cloud`: its diagonal, unless truncated below it
+  coord_type spectrumMax(const point_cloud& cloud) const {
+    coord_type diag=cloud.diag_len();
+    return (this->max_distance_>0 && this->max_distance_<diag) ? this->max_distance_ : diag;
+  }
+
   void computeData(std::shared_ptr<distspctr::histogram<coord_type>> hist, std::vector<QPointF>& dest) {
     size_t sampleCount=hist->total_count();
     for(size_t i=0; i<this->histo_slots_; i++) {
@@ -227,13 +655,41 @@ private:
   size_t histo_slots_;
   std::vector<QPointF> baseline_data_;
   double baseline_progress_;
+  double baseline_error_;
   std::vector<QPointF> experimental_data_;
   double experimental_progress_;
+  double experimental_error_;
   std::vector<QPointF> diff_;
   mutable std::mutex lock_;
 
   std::shared_ptr<filler_type> baseline_filler_;
   std::shared_ptr<filler_type> experimental_filler_;
+  distspctr::fill_options fill_options_;
+  // the observers of the current updates, the only strong references
+  std::shared_ptr<fill_job> baseline_job_;
+  std::shared_ptr<fill_job> experimental_job_;
+  // of the current updates, a notification of another one is stale
+  unsigned long long baseline_generation_;
+  unsigned long long experimental_generation_;
+  // (is baseline, filler) superseded but not yet ended
+  std::vector<std::pair<bool, std::shared_ptr<filler_type>>> retired_;
+
+  // the complete per-cluster-pair spectra of the experimental cloud...
+  pair_histograms pair_cache_;
+  // ... the ones being computed by the experimental_filler_
+  pair_histograms pending_pairs_;
+  // (sampled max, total pairs) the cached spectra were computed with, (0,0) if exhaustive
+  std::pair<size_t, size_t> cached_sampling_;
+  // the intra-cluster spectra, reusable after rigid motions (rescaled,
+  // by the previews only, after similarity ones)...
+  std::map<const PointCluster*, intra_spectrum> intra_cache_;
+  // ... the ones being computed by the experimental_filler_
+  std::map<const PointCluster*, intra_spectrum> pending_intra_;
+  // of the spectra, 0 - the diagonal
+  coord_type max_distance_;
+  // of the last fillers stopped
+  double baseline_stop_seconds_;
+  double experimental_stop_seconds_;
 
 };
 
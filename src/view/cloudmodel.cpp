@@ -5,7 +5,7 @@
 CloudModel::CloudModel(QObject *parent) :
   QObject(parent), clusters_(),
   cloud_({0.0f, 0.0f}, {1.0f, 1.0f}),
-  selection_(nullptr)
+  selection_(nullptr), interacting_(false)
 {
 
 }
@@ -52,6 +52,21 @@ void CloudModel::setSelection(PointCluster* cluster) {
 void CloudModel::clusterPointsUpdated(PointCluster *cluster) {
   if( cluster && this->clusters_.contains(cluster)) {
     emit this->pointsPrechange(this);
+    this->cloud_.invalidate(cluster);
     emit this->pointsChanged(this);
   }
 }
+
+void CloudModel::beginInteraction() {
+  if(!this->interacting_) {
+    this->interacting_=true;
+    emit this->interactionStarted(this);
+  }
+}
+
+void CloudModel::endInteraction() {
+  if(this->interacting_) {
+    this->interacting_=false;
+    emit this->interactionEnded(this);
+  }
+}
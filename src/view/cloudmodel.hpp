@@ -29,19 +29,43 @@ public:
     return this->clusters_;
   }
 
-  void getClusterPoints(const PointCluster* cluster, QVector<p2d>& dest) {
-    this->cloud_.supplier_points(cluster, dest);
+  using point_cloud=distspctr::bbox_npoint_cloud<PointCluster, coord_type, 2>;
+  using points_snapshot=point_cloud::snapshot_type;
+
+  // the current points, the ones of a cluster in the [begin, end) range
+  // (an empty one if the cluster isn't part of the model)
+  std::shared_ptr<const points_snapshot> getClusterPoints(
+    const PointCluster* cluster, size_t& begin, size_t& end
+  ) const {
+    std::shared_ptr<const points_snapshot> ret=this->cloud_.snapshot();
+    size_t ix=ret->index_of(cluster);
+    if(ix<ret->supplier_count()) {
+      begin=ret->begin_of(ix);
+      end=ret->end_of(ix);
+    }
+    else {
+      begin=end=0;
+    }
+    return ret;
   }
 
-  const distspctr::bbox_npoint_cloud<PointCluster, coord_type, 2>& cloud_source() const {
+  const point_cloud& cloud_source() const {
     return this->cloud_;
   }
 
+  // between beginInteraction and endInteraction, the points keep changing
+  // (e.g. while the hull of a cluster is dragged)
+  bool isInteracting() const { return this->interacting_; }
+
 public slots:
   void setSelection(PointCluster* cluster);
 
   void clusterPointsUpdated(PointCluster* cluster);
 
+  void beginInteraction();
+
+  void endInteraction();
+
 signals:
   void selectionChanged(const PointCluster* newSelection);
 
@@ -53,11 +77,17 @@ signals:
 
   void pointsChanged(CloudModel* thizz_);
 
+  void interactionStarted(CloudModel* thizz_);
+
+  void interactionEnded(CloudModel* thizz_);
+
 private:
   QVector<const PointCluster*> clusters_;
-  distspctr::bbox_npoint_cloud<PointCluster, coord_type, 2> cloud_;
+  point_cloud cloud_;
 
   PointCluster* selection_;
+
+  bool interacting_;
 };
 
 #endif // CLOUDMODEL_HPP
@@ -12,6 +12,12 @@ ControllerForm::ControllerForm(QWidget *parent) :
   this->ui->cbExhaustiveDists->setChecked(true);
   this->ui->maxSampleDists->setDisabled(true);
   this->ui->maxSampleDists->setValue(4000000);
+  this->ui->cbAnalyticBaseline->setChecked(true);
+  this->ui->samplingSeed->setValue(4);
+  // off: the adaptive runs stop at varying rounds, their per-cluster-pair
+  // spectra can't be reused (see DiffHistogramCollector::triggerExperimentalUpdate)
+  this->ui->samplingTolerance->setValue(0);
+  this->ui->samplingTolerance->setDisabled(true);
 
   QVBoxLayout* supportLayout=new QVBoxLayout();
   supportLayout->setSizeConstraint(QLayout::SetFixedSize);
@@ -37,6 +43,37 @@ ControllerForm::ControllerForm(QWidget *parent) :
     this->ui->maxSampleDists, sbValChSignal,
     [this](int) { this->updateSampledDistUi(); }
   );
+  using dsb_signal_type=void (QDoubleSpinBox::*)(double);
+  dsb_signal_type dsbValChSignal=&QDoubleSpinBox::valueChanged;
+  QObject::connect(
+    this->ui->samplingTolerance, dsbValChSignal,
+    [this](double tolerance) { this->histogram_collector_->setTolerance(tolerance); }
+  );
+  QObject::connect(
+    this->ui->samplingSeed, sbValChSignal,
+    [this](int seed) {
+      PointCluster::seedPoints(seed);
+      this->histogram_collector_->setSeed(seed);
+    }
+  );
+  using cb_signal_type=void (QComboBox::*)(int);
+  cb_signal_type cbIndexChSignal=&QComboBox::currentIndexChanged;
+  QObject::connect(
+    this->ui->fillEngine, cbIndexChSignal,
+    [this](int) { this->histogram_collector_->setEngine(this->selectedEngine()); }
+  );
+  QObject::connect(
+    this->ui->maxDistance, dsbValChSignal,
+    [this](double maxDistance) { this->histogram_collector_->setMaxDistance(maxDistance); }
+  );
+  QObject::connect(
+    this->ui->cbAnalyticBaseline, cbValChSignal,
+    [this](int) {
+      this->histogram_collector_->setAnalyticBaseline(
+        this->ui->cbAnalyticBaseline->isChecked()
+      );
+    }
+  );
   this->initClouds();
 }
 
@@ -54,9 +91,17 @@ size_t ControllerForm::fillBaselineSeries(QXYSeries& dest, qreal& progPct, qreal
 size_t ControllerForm::fillDiffSeries(QXYSeries& dest, qreal* min, qreal* max) const {
   return this->histogram_collector_->diffSeries(dest, min, max);
 }
+void ControllerForm::samplingErrors(qreal& experimental, qreal& baseline) const {
+  this->histogram_collector_->samplingErrors(experimental, baseline);
+}
+
+void ControllerForm::fillStats(distspctr::fill_stats& experimental, distspctr::fill_stats& baseline) const {
+  this->histogram_collector_->fillStats(experimental, baseline);
+}
 
 
 void ControllerForm::initClouds() {
+  PointCluster::seedPoints(this->ui->samplingSeed->value());
   this->edited_model_=new CloudModel(this);
   auto createdSig=&CloudModel::clusterAdded;
   QObject::connect(
@@ -93,6 +138,13 @@ void ControllerForm::initClouds() {
       }
     }
   );
+  this->histogram_collector_->setSeed(this->ui->samplingSeed->value());
+  this->histogram_collector_->setTolerance(this->ui->samplingTolerance->value());
+  this->histogram_collector_->setEngine(this->selectedEngine());
+  this->histogram_collector_->setMaxDistance(this->ui->maxDistance->value());
+  this->histogram_collector_->setAnalyticBaseline(
+    this->ui->cbAnalyticBaseline->isChecked()
+  );
   // not only this restores the hull to the unit square, but it should trigger
   // an update for the baseline
   QPolygonF d;
@@ -142,6 +194,7 @@ void ControllerForm::editedClusterRemoved(const PointCluster* cluster) {
 
 void ControllerForm::updateSampledDistUi() {
   this->ui->maxSampleDists->setDisabled(this->ui->cbExhaustiveDists->isChecked());
+  this->ui->samplingTolerance->setDisabled(this->ui->cbExhaustiveDists->isChecked());
   size_t maxDistSampleCount=
       this->ui->cbExhaustiveDists->isChecked()
     ? std::numeric_limits<size_t>::max()
@@ -149,3 +202,7 @@ void ControllerForm::updateSampledDistUi() {
   ;
   this->histogram_collector_->setMaxDistSamples(maxDistSampleCount);
 }
+
+distspctr::fill_engine ControllerForm::selectedEngine() const {
+  return static_cast<distspctr::fill_engine>(this->ui->fillEngine->currentIndex());
+}
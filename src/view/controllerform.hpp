@@ -28,6 +28,9 @@ public:
   size_t fillExperimentalSeries(QXYSeries& dest, qreal& progPct, qreal *min=0, qreal *max=0) const;
   size_t fillBaselineSeries(QXYSeries& dest, qreal& progPct, qreal *min=0, qreal *max=0) const;
   size_t fillDiffSeries(QXYSeries& dest, qreal *min=0, qreal *max=0) const;
+  void samplingErrors(qreal& experimental, qreal& baseline) const;
+
+  void fillStats(distspctr::fill_stats& experimental, distspctr::fill_stats& baseline) const;
 
 signals:
   void hasSeriesUpdates(const ControllerForm* thizz);
@@ -52,6 +55,9 @@ private:
 
   void updateSampledDistUi();
 
+  // the engine of the `fillEngine` combo, its items in the fill_engine order
+  distspctr::fill_engine selectedEngine() const;
+
   Ui::ControllerForm *ui;
 
   CloudModel  *edited_model_, *baseline_model_;
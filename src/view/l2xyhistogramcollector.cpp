@@ -3,6 +3,11 @@
 #include "l2xyhistogramcollector.hpp"
 
 #define UPDATE_PCT 0.05
+// during drags: the shortest time between two previews (a display frame),
+// their sampled distances, the stillness before the full update
+#define PREVIEW_FRAME_MS 16
+#define PREVIEW_SAMPLES 100000
+#define REFINE_DEBOUNCE_MS 250
 
 L2XYHistogramCollector::L2XYHistogramCollector(
   const CloudModel& experimental, const CloudModel& baseline,
@@ -13,8 +18,24 @@ L2XYHistogramCollector::L2XYHistogramCollector(
       baseline.cloud_source(), experimental.cloud_source(),
       histogramSlots
     ),
-    dist_(), max_dists_samples_(maxDistCount)
+    dist_(), max_dists_samples_(maxDistCount), analytic_baseline_(false),
+    experimental_model_(experimental),
+    preview_timer_(new QTimer(this)), refine_timer_(new QTimer(this)),
+    drag_pending_(false)
 {
+  this->preview_timer_->setSingleShot(true);
+  this->preview_timer_->setInterval(PREVIEW_FRAME_MS);
+  QObject::connect(
+      this->preview_timer_, &QTimer::timeout,
+      [this]() { this->previewExperimental(); }
+  );
+  this->refine_timer_->setSingleShot(true);
+  this->refine_timer_->setInterval(REFINE_DEBOUNCE_MS);
+  QObject::connect(
+      this->refine_timer_, &QTimer::timeout,
+      [this]() { this->refineExperimental(); }
+  );
+
   auto pstPrechange=&CloudModel::pointsPrechange;
   QObject::connect(
       &baseline, pstPrechange,
@@ -33,13 +54,23 @@ L2XYHistogramCollector::L2XYHistogramCollector(
   QObject::connect(
       &baseline, ptsChange,
       [&](CloudModel*) {
-         this->triggerBaselineUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+         this->updateBaseline();
       }
   );
   QObject::connect(
       &experimental, ptsChange,
       [&](CloudModel*) {
-         this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+         this->experimentalChanged();
+      }
+  );
+  QObject::connect(
+      &experimental, &CloudModel::interactionEnded,
+      [&](CloudModel*) {
+         this->preview_timer_->stop();
+         this->refine_timer_->stop();
+         if(this->drag_pending_) {
+           this->refineExperimental();
+         }
       }
   );
 }
@@ -52,11 +83,100 @@ void L2XYHistogramCollector::setMaxDistSamples(size_t maxDistSamples) {
   ;
   if(maxDistSamples!=this->max_dists_samples_) {
     this->max_dists_samples_=maxDistSamples;
-    this->triggerBaselineUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+    if(!this->analytic_baseline_) {
+      this->updateBaseline();
+    }
     this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
   }
 }
 
+void L2XYHistogramCollector::setAnalyticBaseline(bool analytic) {
+  if(analytic!=this->analytic_baseline_) {
+    this->analytic_baseline_=analytic;
+    this->updateBaseline();
+  }
+}
+
+void L2XYHistogramCollector::setSeed(unsigned long long seed) {
+  if(seed!=this->samplingSeed()) {
+    this->stopBaselineUpdate();
+    this->stopExperimentalUpdate();
+    this->setSamplingSeed(seed);
+    this->updateBaseline();
+    this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+  }
+}
+
+void L2XYHistogramCollector::setTolerance(double tolerance) {
+  if(tolerance!=this->samplingTolerance()) {
+    this->setSamplingTolerance(tolerance);
+    if(this->max_dists_samples_<std::numeric_limits<size_t>::max()) {
+      // maybe sampling
+      this->updateBaseline();
+      this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+    }
+  }
+}
+
+void L2XYHistogramCollector::setEngine(distspctr::fill_engine engine) {
+  if(engine!=this->fillEngine()) {
+    this->stopBaselineUpdate();
+    this->stopExperimentalUpdate();
+    this->setFillEngine(engine);
+    this->updateBaseline();
+    this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+  }
+}
+
+void L2XYHistogramCollector::setMaxDistance(qreal maxDistance) {
+  if(maxDistance!=this->maxDistance()) {
+    this->stopBaselineUpdate();
+    this->stopExperimentalUpdate();
+    this->DiffHistogramCollector::setMaxDistance(maxDistance);
+    this->updateBaseline();
+    this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+  }
+}
+
+void L2XYHistogramCollector::experimentalChanged() {
+  if(!this->experimental_model_.isInteracting()) {
+    this->drag_pending_=false;
+    this->refine_timer_->stop();
+    this->preview_timer_->stop();
+    this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+    return;
+  }
+  this->drag_pending_=true;
+  // the changes in between get folded in the next preview
+  if(!this->preview_timer_->isActive()) {
+    this->preview_timer_->start();
+  }
+  this->refine_timer_->start();
+}
+
+void L2XYHistogramCollector::previewExperimental() {
+  if(this->drag_pending_) {
+    this->triggerExperimentalPreview(
+      this->dist_, std::min(this->max_dists_samples_, size_t(PREVIEW_SAMPLES))
+    );
+  }
+}
+
+void L2XYHistogramCollector::refineExperimental() {
+  this->drag_pending_=false;
+  this->preview_timer_->stop();
+  this->triggerExperimentalUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+}
+
+void L2XYHistogramCollector::updateBaseline() {
+  if(this->analytic_baseline_) {
+    this->triggerAnalyticBaseline();
+  }
+  else {
+    this->triggerBaselineUpdate(this->dist_, UPDATE_PCT, this->max_dists_samples_);
+  }
+}
+
 
 void L2XYHistogramCollector::processUpdate(
   std::shared_ptr<distspctr::histogram<coord_type>> hist, std::vector<QPointF>& dest
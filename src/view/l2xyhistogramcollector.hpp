@@ -2,6 +2,7 @@
 #define L2LINEHISTOGRAMCOLLECTOR_HPP
 
 #include <QObject>
+#include <QTimer>
 
 #include <QtCharts/QXYSeries>
 
@@ -26,6 +27,24 @@ public:
 
   void setMaxDistSamples(size_t maxDistSamples);
 
+  // the baseline from the closed form of the uniform spectrum over
+  // the baseline's bbox, ignoring the baseline's points
+  void setAnalyticBaseline(bool analytic);
+
+  bool isAnalyticBaseline() const { return this->analytic_baseline_; }
+
+  // reseeds the sampled distances, recomputing them if the case
+  void setSeed(unsigned long long seed);
+
+  // 0 - always take all the max samples
+  void setTolerance(double tolerance);
+
+  // of the distances, recomputing them if changed
+  void setEngine(distspctr::fill_engine engine);
+
+  // of the spectra (0 - up to the diagonal), recomputing them if changed
+  void setMaxDistance(qreal maxDistance);
+
 signals:
   void updated(const L2XYHistogramCollector* thizz);
 
@@ -35,7 +54,26 @@ protected:
   );
 
 private:
+  void updateBaseline();
+
+  // While the experimental cloud is being dragged, its changes get
+  // a cheap preview at most once a frame, and the full update only once
+  // the points stay put for a while, or when the drag ends.
+  void experimentalChanged();
+
+  void previewExperimental();
+
+  void refineExperimental();
+
   l2dist dist_;
   size_t max_dists_samples_;
+  bool analytic_baseline_;
+
+  const CloudModel& experimental_model_;
+  // single shot: the next preview, the full update after the last change
+  QTimer* preview_timer_;
+  QTimer* refine_timer_;
+  // changes of the drag not yet fully computed
+  bool drag_pending_;
 };
 #endif // L2LINEHISTOGRAMCOLLECTOR_HPP
@@ -85,6 +85,7 @@ void PointCloudView::mousePressEvent(QMouseEvent *e) {
         }
       }
       if(this->selected_knob_>=0) {
+        this->model_->beginInteraction();
         this->update();
       }
     }
@@ -184,6 +185,9 @@ void PointCloudView::applyDistortion(const QPolygonF& distortionHull) {
 }
 
 void PointCloudView::mouseReleaseEvent(QMouseEvent * /*event*/) {
+  if(this->model_ && this->selected_knob_>=0) {
+    this->model_->endInteraction();
+  }
   this->selected_knob_=-1;
   this->update();
 }
@@ -233,15 +237,16 @@ void PointCloudView::paintEvent(QPaintEvent *e) {
 
   if(this->model_) {
     QPointF probe;
-    QVector<p2d> clusterPoints;
 
     for(const PointCluster* cluster : this->model_->clusters()) {
-      clusterPoints.clear();
-      this->model_->getClusterPoints(cluster, clusterPoints);
+      size_t begin, end;
+      auto snapshot=this->model_->getClusterPoints(cluster, begin, end);
+      const coord_type *xs=snapshot->coords(0), *ys=snapshot->coords(1);
       painter.setPen(QPen(cluster->getColor()));
       painter.setBrush(QBrush(cluster->getColor()));
-      for(auto p : clusterPoints) {
-        assign(probe, p);
+      for(size_t i=begin; i<end; i++) {
+        probe.setX(xs[i]);
+        probe.setY(ys[i]);
         probe=this->global_trn_.map(probe);
         painter.drawPoint(probe);
       }
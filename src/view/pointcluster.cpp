@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "pointcluster.hpp"
 #include "cloudmodel.hpp"
 
@@ -7,7 +9,9 @@ PointCluster::PointCluster(
 ) :
   QObject(owner),
   color_(Qt::GlobalColor::red), transform_(),
-  adapted_transform_(transform_), grp_(&adapted_transform_),
+  adapted_transform_(transform_),
+  last_motion_(motion_kind::rigid), metric_epoch_(0), metric_scale_(1.0),
+  grp_(&adapted_transform_),
   p00(0.75f, 0.0f), p01(0.75f, 0.25f),
   p10(1.0f, 0.0f), p11(1.0f, 0.25f),
   normal_(false), normal_data_(0.3, 2.0)
@@ -33,15 +37,58 @@ PointCluster::PointCluster(
 
 
 PointCluster& PointCluster::updateDistorsion() {
+  QTransform previous=this->transform_;
   QPolygonF distortionHull;
   this->getDistorsionHull(distortionHull);
   QTransform::quadToQuad(PointCluster::unitBox(),distortionHull, this->transform_);
+  double scale=1.0;
+  this->last_motion_=PointCluster::classifyMotion(previous, this->transform_, scale);
+  switch(this->last_motion_) {
+    case motion_kind::rigid:
+      break;
+    case motion_kind::similarity:
+      this->metric_scale_*=scale;
+      break;
+    default:
+      this->newMetricEpoch();
+      break;
+  }
   emit this->pointsUpdated(this);
   return *this;
 }
 
+PointCluster::motion_kind PointCluster::classifyMotion(
+  const QTransform& from, const QTransform& to, double& scale
+) {
+  // Qt maps row vectors, so p*to == (p*from)*delta
+  bool invertible=true;
+  QTransform delta=from.inverted(&invertible)*to;
+  if(!invertible) {
+    return motion_kind::projective;
+  }
+  // the hull knobs are dragged in view coordinates, tolerate the roundings
+  const double eps=1e-6;
+  double w=delta.m33();
+  if(std::abs(delta.m13())>eps*std::abs(w) || std::abs(delta.m23())>eps*std::abs(w)) {
+    return motion_kind::projective;
+  }
+  double a=delta.m11()/w, b=delta.m12()/w, c=delta.m21()/w, d=delta.m22()/w;
+  // the images of the unit vectors need to be orthogonal and of the same length
+  double xx=a*a+b*b, yy=c*c+d*d, xy=a*c+b*d;
+  double tolerance=eps*std::max(xx, yy);
+  if(std::abs(xx-yy)>tolerance || std::abs(xy)>tolerance) {
+    return motion_kind::affine;
+  }
+  scale=std::sqrt(0.5*(xx+yy));
+  if(std::abs(scale-1.0)<=eps) {
+    scale=1.0;
+    return motion_kind::rigid;
+  }
+  return motion_kind::similarity;
+}
+
 void PointCluster::fill(size_t numExtraPoints) {
-  std::mt19937& random=PointCluster::rng();
+  distspctr::philox_engine& random=PointCluster::rng();
   if(this->normal_) {
     double dev=this->normal_data_.deviation;
     double clipR2=this->normal_data_.clipRadius*this->normal_data_.clipRadius;
@@ -62,20 +109,19 @@ void PointCluster::fill(size_t numExtraPoints) {
       numExtraPoints--;
     }
   }
+  this->newMetricEpoch();
   emit this->pointsUpdated(this);
 }
 
-std::mt19937& PointCluster::rng() {
-  static std::mt19937 ret;
-  static bool inited=false;
-  if( ! inited ) {
-    // FIXME init with a random seed -see https://xkcd.com/221/
-    ret.seed(4);
-    inited=true;
-  }
+distspctr::philox_engine& PointCluster::rng() {
+  static distspctr::philox_engine ret(4);
   return ret;
 }
 
+void PointCluster::seedPoints(unsigned long long seed) {
+  PointCluster::rng().seed(seed);
+}
+
 const QPolygonF& PointCluster::unitBox() {
   static QPolygonF ret;
   if(!ret.size()) { // not inited
@@ -9,6 +9,7 @@
 #include <QTransform>
 
 #include "2d.hpp"
+#include "../model/rng.hpp"
 
 class CloudModel;
 
@@ -35,6 +36,15 @@ public:
 
   };
 
+  // How a new distortion relates to the previous one, as far as the
+  // distances between the points of the cluster are concerned
+  enum class motion_kind {
+    rigid,      // unchanged distances
+    similarity, // uniformly scaled distances
+    affine,
+    projective
+  };
+
   PointCluster(
     CloudModel* owner=nullptr,
     size_t initialCount=0, const normal_dist_data* normalData=nullptr
@@ -110,6 +120,16 @@ public:
 
   const QTransform& transform() const { return this->transform_; }
 
+  motion_kind lastMotion() const { return this->last_motion_; }
+
+  // Changes each time the distances between the points change
+  // other than by a uniform scaling (new points, non-similar distortions)
+  unsigned long long metricEpoch() const { return this->metric_epoch_; }
+
+  // The factor the distances between the points got scaled
+  // by since the current metricEpoch() began
+  double metricScale() const { return this->metric_scale_; }
+
   const p2d_grp& cluster() const {
     return this->grp_;
   }
@@ -126,17 +146,22 @@ public:
 
   void clear() {
     this->grp_.clear();
+    this->newMetricEpoch();
     emit this->pointsUpdated(this);
   }
 
   void fill(size_t numExtraPoints);
 
+  // Restarts the random points of all the clusters filled from now
+  // on; the same seed and the same actions give the same points.
+  static void seedPoints(unsigned long long seed);
+
 signals:
   void pointsUpdated(PointCluster*);
 
 private:
   static const QPolygonF& unitBox();
-  static std::mt19937& rng();
+  static distspctr::philox_engine& rng();
 
   const PointCluster& setHullPoint(QPointF& dest, float x, float y) {
     dest.setX(x); dest.setY(y);
@@ -146,9 +171,22 @@ private:
 
   PointCluster& updateDistorsion();
 
+  // `scale` gets the distance scaling factor if not projective or affine
+  static motion_kind classifyMotion(
+    const QTransform& from, const QTransform& to, double& scale
+  );
+
+  void newMetricEpoch() {
+    this->metric_epoch_++;
+    this->metric_scale_=1.0;
+  }
+
   QColor color_;
   QTransform transform_;
   qtrn_adaptor adapted_transform_;
+  motion_kind last_motion_;
+  unsigned long long metric_epoch_;
+  double metric_scale_;
 
   p2d_grp grp_;
   // positions of the "bounding box" corners after distorting